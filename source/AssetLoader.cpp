@@ -0,0 +1,42 @@
+#include "AssetLoader.h"
+
+#include "SDL_image.h"
+
+#include "ThreadPool.h"
+#include "Utils.h"
+#include "VirtualTexture.h"
+
+namespace dae
+{
+	AssetLoader::AssetLoader(ThreadPool& threadPool) :
+		m_ThreadPool{ threadPool }
+	{
+		//IMG_Load loads the PNG library on first use, which is not thread safe, so it is done once here
+		IMG_Init(IMG_INIT_PNG);
+	}
+
+	std::future<std::unique_ptr<Texture>> AssetLoader::LoadTexture(const std::string& path, const TextureLoadOptions& options)
+	{
+		return m_ThreadPool.Enqueue([path, options] { return Texture::LoadFromFile(path, options); });
+	}
+
+	std::future<std::unique_ptr<VirtualTexture>> AssetLoader::LoadVirtualTexture(const std::string& cacheFile, size_t memoryBudget)
+	{
+		return m_ThreadPool.Enqueue([cacheFile, memoryBudget] { return VirtualTexture::LoadFromCache(cacheFile, memoryBudget); });
+	}
+
+	std::future<AssetLoader::MeshData> AssetLoader::LoadMesh(const std::string& path)
+	{
+		return m_ThreadPool.Enqueue([path]
+			{
+				MeshData mesh{};
+				Utils::ParseOBJ(path, mesh.vertices, mesh.indices);
+				return mesh;
+			});
+	}
+
+	std::unique_ptr<Texture> AssetLoader::CreatePlaceholder(uint32_t texel)
+	{
+		return Texture::Generate(1, 1, [texel](int, int, int) { return texel; });
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DataTypes.h"
+#include "Texture.h"
+
+namespace dae
+{
+	class ThreadPool;
+	class VirtualTexture;
+
+	//Decodes textures and parses meshes as background tasks on the thread pool, all assets load in parallel
+	//the caller keeps rendering with placeholders and swaps in every asset as its future becomes ready
+	class AssetLoader final
+	{
+	public:
+		struct MeshData
+		{
+			std::vector<Vertex> vertices{};
+			std::vector<uint32_t> indices{};
+		};
+
+		explicit AssetLoader(ThreadPool& threadPool);
+
+		std::future<std::unique_ptr<Texture>> LoadTexture(const std::string& path, const TextureLoadOptions& options = {});
+		//see VirtualTexture::LoadFromCache, cacheFile is Texture::GetCacheFile of a loaded texture
+		std::future<std::unique_ptr<VirtualTexture>> LoadVirtualTexture(const std::string& cacheFile, size_t memoryBudget);
+		std::future<MeshData> LoadMesh(const std::string& path);
+
+		//moves the result into asset once the future is ready, false while it is still loading or was already taken
+		template<typename T>
+		static bool TryTake(std::future<T>& future, T& asset);
+
+		//1x1 texture with a constant RGBA8 texel (r in the lowest byte), rendered with while the real one loads
+		static std::unique_ptr<Texture> CreatePlaceholder(uint32_t texel);
+
+	private:
+		ThreadPool& m_ThreadPool;
+	};
+
+	template<typename T>
+	bool AssetLoader::TryTake(std::future<T>& future, T& asset)
+	{
+		if (!future.valid() || future.wait_for(std::chrono::seconds{ 0 }) != std::future_status::ready) return false;
+
+		asset = future.get();
+		return true;
+	}
+}
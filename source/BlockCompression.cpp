@@ -0,0 +1,157 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace dae
+{
+	namespace BlockCompression
+	{
+		namespace
+		{
+			uint32_t GetChannel(uint32_t texel, int channel)
+			{
+				return (texel >> (channel * 8)) & 0xff;
+			}
+
+			uint32_t To565(uint32_t r, uint32_t g, uint32_t b)
+			{
+				return ((r * 31 + 127) / 255 << 11) | ((g * 63 + 127) / 255 << 5) | ((b * 31 + 127) / 255);
+			}
+
+			uint32_t SqrDistance(uint32_t color0, uint32_t color1)
+			{
+				uint32_t distance{};
+				for (int channel{}; channel < 3; ++channel)
+				{
+					const int delta{ static_cast<int>(GetChannel(color0, channel)) - static_cast<int>(GetChannel(color1, channel)) };
+					distance += static_cast<uint32_t>(delta * delta);
+				}
+				return distance;
+			}
+		}
+
+		void EncodeBC1Block(const uint32_t texels[16], uint32_t* pBlock)
+		{
+			//bounding box of the block colors
+			uint32_t minColor[3]{ 255, 255, 255 };
+			uint32_t maxColor[3]{};
+			uint32_t mean[3]{};
+			for (int i{}; i < 16; ++i)
+			{
+				for (int channel{}; channel < 3; ++channel)
+				{
+					const uint32_t value{ GetChannel(texels[i], channel) };
+					minColor[channel] = std::min(minColor[channel], value);
+					maxColor[channel] = std::max(maxColor[channel], value);
+					mean[channel] += value;
+				}
+			}
+
+			//the box diagonal only follows the colors when the channels correlate positively,
+			//flip the channels that go against the channel with the largest range
+			int primary{};
+			for (int channel{ 1 }; channel < 3; ++channel)
+			{
+				if (maxColor[channel] - minColor[channel] > maxColor[primary] - minColor[primary]) primary = channel;
+			}
+			for (int channel{}; channel < 3; ++channel)
+			{
+				if (channel == primary) continue;
+
+				int covariance{};
+				for (int i{}; i < 16; ++i)
+				{
+					covariance += (static_cast<int>(GetChannel(texels[i], primary) * 16) - static_cast<int>(mean[primary]))
+						* (static_cast<int>(GetChannel(texels[i], channel) * 16) - static_cast<int>(mean[channel]));
+				}
+				if (covariance < 0) std::swap(minColor[channel], maxColor[channel]);
+			}
+
+			//inset by 1/16 of the range, the extremes are rarely worth an exact endpoint
+			for (int channel{}; channel < 3; ++channel)
+			{
+				const int inset{ (static_cast<int>(maxColor[channel]) - static_cast<int>(minColor[channel])) / 16 };
+				maxColor[channel] = static_cast<uint32_t>(static_cast<int>(maxColor[channel]) - inset);
+				minColor[channel] = static_cast<uint32_t>(static_cast<int>(minColor[channel]) + inset);
+			}
+
+			uint32_t color0{ To565(maxColor[0], maxColor[1], maxColor[2]) };
+			uint32_t color1{ To565(minColor[0], minColor[1], minColor[2]) };
+
+			//4 color mode needs color0 > color1, one color for the whole block otherwise
+			if (color0 < color1) std::swap(color0, color1);
+			pBlock[0] = color0 | (color1 << 16);
+			pBlock[1] = 0;
+			if (color0 == color1) return;
+
+			const uint32_t rgba0{ Expand565(color0) };
+			const uint32_t rgba1{ Expand565(color1) };
+			const uint32_t palette[4]{ rgba0, rgba1, BlendColor(rgba0, rgba1, 2, 1, 3), BlendColor(rgba0, rgba1, 1, 2, 3) };
+
+			for (int i{}; i < 16; ++i)
+			{
+				uint32_t bestIndex{};
+				uint32_t bestDistance{ SqrDistance(texels[i], palette[0]) };
+				for (uint32_t index{ 1 }; index < 4; ++index)
+				{
+					const uint32_t distance{ SqrDistance(texels[i], palette[index]) };
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						bestIndex = index;
+					}
+				}
+				pBlock[1] |= bestIndex << (i * 2);
+			}
+		}
+
+		void EncodeBC4Block(const uint32_t texels[16], int channel, uint32_t* pBlock)
+		{
+			uint32_t minValue{ 255 };
+			uint32_t maxValue{};
+			for (int i{}; i < 16; ++i)
+			{
+				minValue = std::min(minValue, GetChannel(texels[i], channel));
+				maxValue = std::max(maxValue, GetChannel(texels[i], channel));
+			}
+
+			//8 value mode (value0 > value1), a flat block only needs index 0
+			uint64_t bits{ maxValue | (minValue << 8) };
+			if (maxValue != minValue)
+			{
+				uint32_t palette[8]{ maxValue, minValue };
+				for (uint32_t index{ 2 }; index < 8; ++index)
+				{
+					palette[index] = ((8 - index) * maxValue + (index - 1) * minValue) / 7;
+				}
+
+				for (int i{}; i < 16; ++i)
+				{
+					const int value{ static_cast<int>(GetChannel(texels[i], channel)) };
+					uint64_t bestIndex{};
+					int bestDistance{ 256 };
+					for (uint32_t index{}; index < 8; ++index)
+					{
+						const int distance{ std::abs(value - static_cast<int>(palette[index])) };
+						if (distance < bestDistance)
+						{
+							bestDistance = distance;
+							bestIndex = index;
+						}
+					}
+					bits |= bestIndex << (16 + i * 3);
+				}
+			}
+
+			pBlock[0] = static_cast<uint32_t>(bits);
+			pBlock[1] = static_cast<uint32_t>(bits >> 32);
+		}
+
+		void EncodeBC5Block(const uint32_t texels[16], uint32_t* pBlock)
+		{
+			EncodeBC4Block(texels, 0, pBlock);
+			EncodeBC4Block(texels, 1, pBlock + bc4BlockWords);
+		}
+	}
+}
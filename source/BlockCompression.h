@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+
+//Software BC1/BC4/BC5 (DXT1/ATI1/ATI2) block codecs
+//a block covers 4x4 texels, texel index = x + 4 * y inside the block
+//texels are RGBA8 packed in a uint32 with r in the lowest byte, same as Texture
+//blocks are stored as little-endian uint32 words: BC1/BC4 = 2 words (8 bytes), BC5 = 4 words (16 bytes)
+namespace dae
+{
+	namespace BlockCompression
+	{
+		constexpr int bc1BlockWords{ 2 };
+		constexpr int bc4BlockWords{ 2 };
+		constexpr int bc5BlockWords{ 4 };
+
+		void EncodeBC1Block(const uint32_t texels[16], uint32_t* pBlock);
+		//channel: 0 = r, 1 = g, 2 = b, 3 = a
+		void EncodeBC4Block(const uint32_t texels[16], int channel, uint32_t* pBlock);
+		//r and g go into two BC4 blocks, b is reconstructed when decoding
+		void EncodeBC5Block(const uint32_t texels[16], uint32_t* pBlock);
+
+		inline uint32_t Expand565(uint32_t color)
+		{
+			const uint32_t r{ (color >> 11) & 31 };
+			const uint32_t g{ (color >> 5) & 63 };
+			const uint32_t b{ color & 31 };
+			return ((r << 3) | (r >> 2)) | (((g << 2) | (g >> 4)) << 8) | (((b << 3) | (b >> 2)) << 16) | 0xff000000;
+		}
+
+		//weighted average of two RGBA8 colors, weight0 + weight1 == divisor
+		inline uint32_t BlendColor(uint32_t color0, uint32_t color1, uint32_t weight0, uint32_t weight1, uint32_t divisor)
+		{
+			uint32_t result{ 0xff000000 };
+			for (uint32_t shift{}; shift < 24; shift += 8)
+			{
+				const uint32_t channel{ (((color0 >> shift) & 0xff) * weight0 + ((color1 >> shift) & 0xff) * weight1) / divisor };
+				result |= channel << shift;
+			}
+			return result;
+		}
+
+		inline uint32_t DecodeBC1Texel(const uint32_t* pBlock, int texelIndex)
+		{
+			const uint32_t color0{ pBlock[0] & 0xffff };
+			const uint32_t color1{ pBlock[0] >> 16 };
+			const uint32_t index{ (pBlock[1] >> (texelIndex * 2)) & 3 };
+
+			const uint32_t rgba0{ Expand565(color0) };
+			const uint32_t rgba1{ Expand565(color1) };
+
+			switch (index)
+			{
+			case 0: return rgba0;
+			case 1: return rgba1;
+			case 2: return color0 > color1 ? BlendColor(rgba0, rgba1, 2, 1, 3) : BlendColor(rgba0, rgba1, 1, 1, 2);
+			default: return color0 > color1 ? BlendColor(rgba0, rgba1, 1, 2, 3) : 0; //3 color mode: transparent black
+			}
+		}
+
+		inline uint32_t DecodeBC4Value(const uint32_t* pBlock, int texelIndex)
+		{
+			const uint32_t value0{ pBlock[0] & 0xff };
+			const uint32_t value1{ (pBlock[0] >> 8) & 0xff };
+
+			//48 bits of 3 bit indices start at bit 16
+			const uint64_t bits{ static_cast<uint64_t>(pBlock[0]) | (static_cast<uint64_t>(pBlock[1]) << 32) };
+			const uint32_t index{ static_cast<uint32_t>(bits >> (16 + texelIndex * 3)) & 7 };
+
+			if (index == 0) return value0;
+			if (index == 1) return value1;
+
+			if (value0 > value1)
+				return ((8 - index) * value0 + (index - 1) * value1) / 7;
+
+			if (index == 6) return 0;
+			if (index == 7) return 255;
+			return ((6 - index) * value0 + (index - 1) * value1) / 5;
+		}
+
+		//single channel, replicated into r, g and b
+		inline uint32_t DecodeBC4Texel(const uint32_t* pBlock, int texelIndex)
+		{
+			const uint32_t value{ DecodeBC4Value(pBlock, texelIndex) };
+			return value | (value << 8) | (value << 16) | 0xff000000;
+		}
+
+		//tangent-space normal: x and y are stored, z = sqrt(1 - x^2 - y^2), all remapped to [0, 255]
+		inline uint32_t DecodeBC5Texel(const uint32_t* pBlock, int texelIndex)
+		{
+			const uint32_t r{ DecodeBC4Value(pBlock, texelIndex) };
+			const uint32_t g{ DecodeBC4Value(pBlock + bc4BlockWords, texelIndex) };
+
+			const float x{ r * (2.f / 255.f) - 1.f };
+			const float y{ g * (2.f / 255.f) - 1.f };
+			const float zSquared{ 1.f - x * x - y * y };
+			const float z{ zSquared > 0.f ? std::sqrt(zSquared) : 0.f };
+			const uint32_t b{ static_cast<uint32_t>((z * 0.5f + 0.5f) * 255.f + 0.5f) };
+
+			return r | (g << 8) | (b << 16) | 0xff000000;
+		}
+	}
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "Math.h"
+
+namespace dae
+{
+	struct BoundingBox
+	{
+		Vector3 min{ FLT_MAX, FLT_MAX, FLT_MAX };
+		Vector3 max{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		bool IsEmpty() const { return min.x > max.x; }
+		Vector3 GetCenter() const { return (min + max) * 0.5f; }
+		Vector3 GetExtents() const { return (max - min) * 0.5f; }
+
+		void Grow(const Vector3& point)
+		{
+			min = { std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z) };
+			max = { std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z) };
+		}
+
+		void Grow(const BoundingBox& box)
+		{
+			Grow(box.min);
+			Grow(box.max);
+		}
+
+		bool Contains(const Vector3& point) const
+		{
+			return point.x >= min.x && point.y >= min.y && point.z >= min.z && point.x <= max.x && point.y <= max.y && point.z <= max.z;
+		}
+
+		Vector3 GetCorner(int corner) const
+		{
+			return { (corner & 1) ? max.x : min.x, (corner & 2) ? max.y : min.y, (corner & 4) ? max.z : min.z };
+		}
+
+		//box around the transformed box (center moved, extents through the absolute 3x3 part)
+		BoundingBox Transformed(const Matrix& matrix) const
+		{
+			const Vector3 center{ matrix.TransformPoint(GetCenter()) };
+			const Vector3 extents{ GetExtents() };
+			Vector3 newExtents{};
+			for (int column{}; column < 3; ++column)
+			{
+				newExtents[column] = fabsf(matrix[0][column]) * extents.x + fabsf(matrix[1][column]) * extents.y + fabsf(matrix[2][column]) * extents.z;
+			}
+			return BoundingBox{ center - newExtents, center + newExtents };
+		}
+	};
+
+	struct BoundingSphere
+	{
+		Vector3 center{};
+		float radius{};
+
+		//the radius grows with the largest axis scale
+		BoundingSphere Transformed(const Matrix& matrix) const
+		{
+			const float scale{ std::max({ matrix.GetAxisX().Magnitude(), matrix.GetAxisY().Magnitude(), matrix.GetAxisZ().Magnitude() }) };
+			return BoundingSphere{ matrix.TransformPoint(center), radius * scale };
+		}
+	};
+
+	//inside: Dot(normal, p) + distance >= 0
+	struct Plane
+	{
+		Vector3 normal{};
+		float distance{};
+
+		float GetSignedDistance(const Vector3& point) const { return Vector3::Dot(normal, point) + distance; }
+	};
+
+	enum class Containment
+	{
+		outside, intersects, inside
+	};
+
+	//The 6 planes of a view frustum, pointing inwards
+	struct Frustum
+	{
+		//left, right, bottom, top, near, far
+		Plane planes[6]{};
+
+		//planes of the clip volume -w <= x, y <= w, 0 <= z <= w of viewProjection (row vectors: clip = p * viewProjection)
+		static Frustum FromViewProjection(const Matrix& viewProjection)
+		{
+			const auto column = [&viewProjection](int index)
+			{
+				return Vector4{ viewProjection[0][index], viewProjection[1][index], viewProjection[2][index], viewProjection[3][index] };
+			};
+			const Vector4 x{ column(0) };
+			const Vector4 y{ column(1) };
+			const Vector4 z{ column(2) };
+			const Vector4 w{ column(3) };
+
+			Frustum frustum{};
+			const Vector4 planes[6]{ w + x, w - x, w + y, w - y, z, w - z };
+			for (int i{}; i < 6; ++i)
+			{
+				const Vector3 normal{ planes[i].x, planes[i].y, planes[i].z };
+				const float invLength{ 1.f / normal.Magnitude() };
+				frustum.planes[i] = Plane{ normal * invLength, planes[i].w * invLength };
+			}
+			return frustum;
+		}
+
+		bool IsOutside(const BoundingSphere& sphere) const
+		{
+			for (const Plane& plane : planes)
+			{
+				if (plane.GetSignedDistance(sphere.center) < -sphere.radius) return true;
+			}
+			return false;
+		}
+
+		//per plane the corner farthest along the normal decides outside, the nearest one inside
+		Containment Classify(const BoundingBox& box) const
+		{
+			Containment result{ Containment::inside };
+			for (const Plane& plane : planes)
+			{
+				const Vector3 farthest{ plane.normal.x >= 0.f ? box.max.x : box.min.x, plane.normal.y >= 0.f ? box.max.y : box.min.y, plane.normal.z >= 0.f ? box.max.z : box.min.z };
+				if (plane.GetSignedDistance(farthest) < 0.f) return Containment::outside;
+
+				const Vector3 nearest{ plane.normal.x >= 0.f ? box.min.x : box.max.x, plane.normal.y >= 0.f ? box.min.y : box.max.y, plane.normal.z >= 0.f ? box.min.z : box.max.z };
+				if (plane.GetSignedDistance(nearest) < 0.f) result = Containment::intersects;
+			}
+			return result;
+		}
+	};
+}
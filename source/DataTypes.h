@@ -1,6 +1,13 @@
 #pragma once
+#include <algorithm>
+#include "Bounds.h"
 #include "Math.h"
+#include "FrameArena.h"
+#include "Meshlet.h"
+#include "Timer.h"
+#include "Varying.h"
 #include "vector"
+#include <initializer_list>
 
 namespace dae
 {
@@ -14,14 +21,42 @@ namespace dae
 		Vector3 viewDirection{}; //W4
 	};
 
-	struct Vertex_Out
+	//every world-space attribute, what the fixed-function paths (VertexTransformationFunction) output
+	using Vertex_Out = Varying<VaryingAttribute::worldSpace>;
+
+	//Structure-of-arrays copy of Mesh::vertices for the SIMD vertex stage
+	//every stream is padded with zeros to a multiple of 4 so the kernel never needs a scalar tail
+	struct VertexStreamSoA
 	{
-		Vector4 position{};
-		ColorRGB color{ colors::White };
-		Vector2 uv{};
-		Vector3 normal{};
-		Vector3 tangent{};
-		Vector3 viewDirection{};
+		size_t count{};
+
+		std::vector<float> positionX{}, positionY{}, positionZ{};
+		std::vector<float> colorR{}, colorG{}, colorB{};
+		std::vector<float> u{}, v{};
+		std::vector<float> normalX{}, normalY{}, normalZ{};
+		std::vector<float> tangentX{}, tangentY{}, tangentZ{};
+
+		void Build(const std::vector<Vertex>& vertices)
+		{
+			count = vertices.size();
+			const size_t paddedCount{ (count + 3) & ~size_t(3) };
+
+			for (std::vector<float>* pStream : { &positionX, &positionY, &positionZ, &colorR, &colorG, &colorB, &u, &v,
+				&normalX, &normalY, &normalZ, &tangentX, &tangentY, &tangentZ })
+			{
+				pStream->assign(paddedCount, 0.f);
+			}
+
+			for (size_t i{}; i < count; ++i)
+			{
+				const Vertex& vertex{ vertices[i] };
+				positionX[i] = vertex.position.x; positionY[i] = vertex.position.y; positionZ[i] = vertex.position.z;
+				colorR[i] = vertex.color.r; colorG[i] = vertex.color.g; colorB[i] = vertex.color.b;
+				u[i] = vertex.uv.x; v[i] = vertex.uv.y;
+				normalX[i] = vertex.normal.x; normalY[i] = vertex.normal.y; normalZ[i] = vertex.normal.z;
+				tangentX[i] = vertex.tangent.x; tangentY[i] = vertex.tangent.y; tangentZ[i] = vertex.tangent.z;
+			}
+		}
 	};
 
 	enum class PrimitiveTopology
@@ -36,8 +71,40 @@ namespace dae
 		std::vector<uint32_t> indices{};
 		PrimitiveTopology primitiveTopology{ PrimitiveTopology::TriangleStrip };
 
-		std::vector<Vertex_Out> vertices_out{};
+		ArenaArray<Vertex_Out> vertices_out{};
 		Matrix worldMatrix{};
+		//object-space bounds of vertices, set by BuildVertexStream
+		BoundingBox bounds{};
+		BoundingSphere boundingSphere{};
+		//the mesh split into meshlets, the only vertex stream the pipeline and the shadow map read, set by BuildVertexStream
+		std::vector<Meshlet> meshlets{};
+		std::vector<uint8_t> meshletTriangles{};
+		VertexStreamSoA meshletVerticesSoA{};
+		//every edge is shared by exactly two triangles, so back faces are hidden from outside (see MeshletCulling)
+		bool isClosed{};
+		//vertices.size() when the stream was built, a different size means it has to be built again
+		size_t streamVertexCount{};
+
+		void BuildVertexStream()
+		{
+			streamVertexCount = vertices.size();
+			BuildMeshlets();
+
+			bounds = BoundingBox{};
+			for (const Vertex& vertex : vertices)
+			{
+				bounds.Grow(vertex.position);
+			}
+			boundingSphere = BoundingSphere{ bounds.GetCenter(), 0.f };
+			for (const Vertex& vertex : vertices)
+			{
+				boundingSphere.radius = std::max(boundingSphere.radius, (vertex.position - boundingSphere.center).Magnitude());
+			}
+		}
+
+		//see Meshlet.cpp
+		void BuildMeshlets();
+
 		void Translate(const Vector3& translation)
 		{
 			worldMatrix *= Matrix::CreateTranslation(translation);
@@ -0,0 +1,51 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+namespace dae
+{
+	//Picks the render resolution for the next frame from the frame time of the last ones
+	//the scale applies to both axes, so the pixel count (what the frame time mostly depends on) goes with scale squared
+	class DynamicResolution final
+	{
+	public:
+		//targetFrameTime in seconds
+		explicit DynamicResolution(float targetFrameTime)
+			: m_TargetFrameTime{ targetFrameTime }
+		{
+		}
+
+		//frameTime: Timer::GetElapsed of the last frame
+		void Update(float frameTime)
+		{
+			if (frameTime <= 0.f) return;
+			m_SmoothedFrameTime = m_SmoothedFrameTime == 0.f ? frameTime : m_SmoothedFrameTime + (frameTime - m_SmoothedFrameTime) * smoothing;
+
+			//close enough, changing the resolution every frame would only make the image shimmer
+			const float ratio{ m_TargetFrameTime / m_SmoothedFrameTime };
+			if (ratio > 1.f - deadZone && ratio < 1.f + deadZone) return;
+
+			const float wantedScale{ m_Scale * sqrtf(ratio) };
+			m_Scale = std::clamp(std::clamp(wantedScale, m_Scale - maxStep, m_Scale + maxStep), minScale, 1.f);
+		}
+
+		void Reset() { m_Scale = 1.f; m_SmoothedFrameTime = 0.f; }
+
+		float GetScale() const { return m_Scale; }
+		float GetTargetFrameTime() const { return m_TargetFrameTime; }
+		//the part of a maxWidth x maxHeight buffer to render into, never 0
+		int GetWidth(int maxWidth) const { return std::max(static_cast<int>(maxWidth * m_Scale + 0.5f), 1); }
+		int GetHeight(int maxHeight) const { return std::max(static_cast<int>(maxHeight * m_Scale + 0.5f), 1); }
+
+	private:
+		static constexpr float minScale{ 0.5f };
+		//per frame
+		static constexpr float maxStep{ 0.05f };
+		static constexpr float smoothing{ 0.1f };
+		static constexpr float deadZone{ 0.05f };
+
+		float m_TargetFrameTime{};
+		float m_SmoothedFrameTime{};
+		float m_Scale{ 1.f };
+	};
+}
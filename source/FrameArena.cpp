@@ -0,0 +1,112 @@
+#include "FrameArena.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace dae
+{
+	FrameArena::FrameArena(size_t capacity) :
+		m_pBuffer{ std::make_unique<std::byte[]>(capacity) },
+		m_Capacity{ capacity }
+	{
+	}
+
+	void FrameArena::Reset()
+	{
+		//last frame did not fit, grow once to what it actually needed
+		if (!m_OverflowBlocks.empty())
+		{
+			m_OverflowBlocks.clear();
+			m_Capacity = m_HighWaterMark;
+			m_pBuffer = std::make_unique<std::byte[]>(m_Capacity);
+		}
+
+		m_Offset = 0;
+		m_Used = 0;
+	}
+
+	void* FrameArena::Allocate(size_t size, size_t alignment)
+	{
+		assert((alignment & (alignment - 1)) == 0 && "FrameArena: alignment has to be a power of 2");
+
+		const size_t alignedOffset{ (m_Offset + alignment - 1) & ~(alignment - 1) };
+
+		//worst case padding is counted so the grown arena is guaranteed to fit the same frame
+		m_Used += size + alignment - 1;
+		if (m_Used > m_HighWaterMark) m_HighWaterMark = m_Used;
+
+		if (alignedOffset + size <= m_Capacity)
+		{
+			m_Offset = alignedOffset + size;
+			return m_pBuffer.get() + alignedOffset;
+		}
+
+		//out of space, std::byte[] is only guaranteed to be aligned to max_align_t
+		assert(alignment <= alignof(std::max_align_t));
+		m_OverflowBlocks.emplace_back(std::make_unique<std::byte[]>(size));
+		return m_OverflowBlocks.back().get();
+	}
+
+	namespace HeapTracking
+	{
+		std::atomic<uint64_t> g_AllocationCount{};
+
+		uint64_t GetAllocationCount()
+		{
+			return g_AllocationCount.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+//Global operator new/delete replacements, only there to count heap allocations
+//the array and nothrow versions forward to these by default
+void* operator new(size_t size)
+{
+	dae::HeapTracking::g_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	if (void* pMemory = std::malloc(size ? size : 1))
+		return pMemory;
+
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+	std::free(pMemory);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	dae::HeapTracking::g_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+
+#ifdef _MSC_VER
+	void* pMemory{ _aligned_malloc(size ? size : 1, static_cast<size_t>(alignment)) };
+#else
+	const size_t alignedSize{ ((size ? size : 1) + static_cast<size_t>(alignment) - 1) & ~(static_cast<size_t>(alignment) - 1) };
+	void* pMemory{ std::aligned_alloc(static_cast<size_t>(alignment), alignedSize) };
+#endif
+	if (pMemory)
+		return pMemory;
+
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* pMemory, std::align_val_t) noexcept
+{
+#ifdef _MSC_VER
+	_aligned_free(pMemory);
+#else
+	std::free(pMemory);
+#endif
+}
+
+void operator delete(void* pMemory, size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(pMemory, alignment);
+}
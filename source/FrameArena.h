@@ -0,0 +1,77 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace dae
+{
+	//Fixed-size array living in a FrameArena, only valid until the next FrameArena::Reset
+	template<typename T>
+	struct ArenaArray
+	{
+		T* pData{ nullptr };
+		size_t count{};
+
+		size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+		T* data() { return pData; }
+		const T* data() const { return pData; }
+
+		T* begin() { return pData; }
+		T* end() { return pData + count; }
+		const T* begin() const { return pData; }
+		const T* end() const { return pData + count; }
+
+		T& operator[](size_t index) { assert(index < count); return pData[index]; }
+		const T& operator[](size_t index) const { assert(index < count); return pData[index]; }
+	};
+
+	//Linear allocator for transient per-frame pipeline data
+	//allocating is a pointer bump, Reset at the start of the frame frees everything in O(1)
+	//when a frame needs more than the capacity, the extra memory comes from the heap
+	//and the arena grows to the high-water mark on the next Reset, so the steady state never touches the heap
+	class FrameArena final
+	{
+	public:
+		explicit FrameArena(size_t capacity);
+		~FrameArena() = default;
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena(FrameArena&&) noexcept = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+		FrameArena& operator=(FrameArena&&) noexcept = delete;
+
+		void Reset();
+		void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+		//memory is left uninitialized, the caller has to write every element
+		template<typename T>
+		ArenaArray<T> AllocateArray(size_t count)
+		{
+			static_assert(std::is_trivially_destructible_v<T>, "FrameArena never runs destructors");
+			return { static_cast<T*>(Allocate(sizeof(T) * count, alignof(T))), count };
+		}
+
+		size_t GetCapacity() const { return m_Capacity; }
+		size_t GetUsed() const { return m_Used; }
+		size_t GetHighWaterMark() const { return m_HighWaterMark; }
+
+	private:
+		std::unique_ptr<std::byte[]> m_pBuffer{ nullptr };
+		size_t m_Capacity{};
+		size_t m_Offset{};
+		size_t m_Used{};
+		size_t m_HighWaterMark{};
+
+		std::vector<std::unique_ptr<std::byte[]>> m_OverflowBlocks{};
+	};
+
+	namespace HeapTracking
+	{
+		//Total number of global operator new calls since startup
+		uint64_t GetAllocationCount();
+	}
+}
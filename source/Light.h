@@ -0,0 +1,101 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+#include "Math.h"
+
+namespace dae
+{
+	enum class LightType
+	{
+		directional, point, spot
+	};
+
+	//Light in world space
+	//directional: direction only, reaches everything
+	//point: position + range, the falloff reaches 0 at range
+	//spot: point light limited to a cone around direction, full intensity inside the inner angle
+	struct Light
+	{
+		LightType type{ LightType::point };
+		Vector3 position{};
+		//the direction the light travels in (directional, spot)
+		Vector3 direction{ Vector3::UnitZ };
+		ColorRGB color{ colors::White };
+		float intensity{ 1.f };
+		float range{ 10.f };
+		//cosines of the half angles
+		float innerConeCos{ 1.f };
+		float outerConeCos{ 0.f };
+
+		static Light CreateDirectional(const Vector3& direction, const ColorRGB& color, float intensity)
+		{
+			Light light{};
+			light.type = LightType::directional;
+			light.direction = direction.Normalized();
+			light.color = color;
+			light.intensity = intensity;
+			return light;
+		}
+
+		static Light CreatePoint(const Vector3& position, const ColorRGB& color, float intensity, float range)
+		{
+			Light light{};
+			light.type = LightType::point;
+			light.position = position;
+			light.color = color;
+			light.intensity = intensity;
+			light.range = range;
+			return light;
+		}
+
+		//angles in degrees, measured from the cone axis
+		static Light CreateSpot(const Vector3& position, const Vector3& direction, const ColorRGB& color, float intensity, float range,
+			float innerAngle, float outerAngle)
+		{
+			Light light{ CreatePoint(position, color, intensity, range) };
+			light.type = LightType::spot;
+			light.direction = direction.Normalized();
+			light.innerConeCos = cosf(innerAngle * TO_RADIANS);
+			light.outerConeCos = cosf(outerAngle * TO_RADIANS);
+			return light;
+		}
+	};
+
+	//What a light delivers at one point
+	struct LightSample
+	{
+		//the direction the light travels in, normalized
+		Vector3 direction{};
+		ColorRGB radiance{};
+	};
+
+	inline LightSample EvaluateLight(const Light& light, const Vector3& worldPosition)
+	{
+		if (light.type == LightType::directional)
+		{
+			return LightSample{ light.direction, light.intensity * light.color };
+		}
+
+		Vector3 toPoint{ worldPosition - light.position };
+		const float distanceSquared{ toPoint.SqrMagnitude() };
+		if (distanceSquared >= light.range * light.range || distanceSquared == 0.f) return {};
+
+		const float distance{ sqrtf(distanceSquared) };
+		toPoint /= distance;
+
+		//inverse square, windowed so it reaches exactly 0 at range (the bounds the light culling uses)
+		const float ratio{ distanceSquared / (light.range * light.range) };
+		const float window{ (1.f - ratio * ratio) };
+		float attenuation{ window * window / (distanceSquared + 1.f) };
+
+		if (light.type == LightType::spot)
+		{
+			const float cosAngle{ Vector3::Dot(toPoint, light.direction) };
+			const float cone{ std::clamp((cosAngle - light.outerConeCos) / (light.innerConeCos - light.outerConeCos), 0.f, 1.f) };
+			attenuation *= cone * cone;
+		}
+
+		return LightSample{ toPoint, light.intensity * attenuation * light.color };
+	}
+}
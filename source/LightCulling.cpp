@@ -0,0 +1,172 @@
+#include "LightCulling.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+
+#include "ThreadPool.h"
+
+using namespace dae;
+
+void TiledLightCulling::Build(const std::vector<Light>& lights, const Camera& camera, const float* pDepthBuffer, int samplesPerPixel, int width, int height, ThreadPool& threadPool)
+{
+	assert(lights.size() <= UINT16_MAX && "TiledLightCulling: light indices are 16 bit");
+
+	const int tilesX{ (width + tileSize - 1) / tileSize };
+	const int tilesY{ (height + tileSize - 1) / tileSize };
+	if (tilesX != m_TilesX || tilesY != m_TilesY)
+	{
+		m_TilesX = tilesX;
+		m_TilesY = tilesY;
+		const size_t tileCount{ static_cast<size_t>(tilesX) * tilesY };
+		m_TileMinDepth.assign(tileCount, FLT_MAX);
+		m_TileMaxDepth.assign(tileCount, -FLT_MAX);
+		m_TileLightIndices.assign(tileCount * maxLightsPerTile, 0);
+		m_TileLightCounts.assign(tileCount, 0);
+	}
+
+	ComputeTileDepthRanges(pDepthBuffer, samplesPerPixel, width, height, threadPool);
+
+	//screen + depth bounds per light, lights that are off screen are left out
+	m_LightBounds.resize(lights.size());
+	m_VisibleLights.clear();
+	for (size_t i{}; i < lights.size(); ++i)
+	{
+		if (ComputeLightBounds(lights[i], camera, width, height, m_LightBounds[i]))
+		{
+			m_VisibleLights.push_back(static_cast<uint16_t>(i));
+		}
+	}
+
+	//one tile row per chunk, every tile only writes its own slots
+	threadPool.ParallelFor(static_cast<size_t>(m_TilesY), 1, [&](size_t begin, size_t end)
+		{
+			for (int tileY{ static_cast<int>(begin) }; tileY < static_cast<int>(end); ++tileY)
+			{
+				for (int tileX{}; tileX < m_TilesX; ++tileX)
+				{
+					const size_t tile{ static_cast<size_t>(tileY) * m_TilesX + tileX };
+					const float tileMinDepth{ m_TileMinDepth[tile] };
+					const float tileMaxDepth{ m_TileMaxDepth[tile] };
+					uint16_t* pIndices{ &m_TileLightIndices[tile * maxLightsPerTile] };
+					uint32_t count{};
+
+					//nothing drawn in the tile, nothing to light
+					if (tileMinDepth <= tileMaxDepth)
+					{
+						for (const uint16_t lightIndex : m_VisibleLights)
+						{
+							const LightBounds& bounds{ m_LightBounds[lightIndex] };
+							if (tileX < bounds.minTileX || tileX > bounds.maxTileX || tileY < bounds.minTileY || tileY > bounds.maxTileY) continue;
+							if (bounds.maxDepth < tileMinDepth || bounds.minDepth > tileMaxDepth) continue;
+
+							if (count < maxLightsPerTile) pIndices[count] = lightIndex;
+							++count;
+						}
+					}
+					m_TileLightCounts[tile] = count;
+				}
+			}
+		});
+
+	m_AssignmentCount = 0;
+	m_DroppedCount = 0;
+	for (uint32_t& count : m_TileLightCounts)
+	{
+		if (count > maxLightsPerTile)
+		{
+			m_DroppedCount += count - maxLightsPerTile;
+			count = maxLightsPerTile;
+		}
+		m_AssignmentCount += count;
+	}
+}
+
+void TiledLightCulling::ComputeTileDepthRanges(const float* pDepthBuffer, int samplesPerPixel, int width, int height, ThreadPool& threadPool)
+{
+	threadPool.ParallelFor(static_cast<size_t>(m_TilesY), 1, [&](size_t begin, size_t end)
+		{
+			for (int tileY{ static_cast<int>(begin) }; tileY < static_cast<int>(end); ++tileY)
+			{
+				const int minY{ tileY * tileSize };
+				const int maxY{ std::min(minY + tileSize, height) };
+				for (int tileX{}; tileX < m_TilesX; ++tileX)
+				{
+					const int minX{ tileX * tileSize };
+					const int maxX{ std::min(minX + tileSize, width) };
+
+					float minDepth{ FLT_MAX };
+					float maxDepth{ -FLT_MAX };
+					for (int py{ minY }; py < maxY; ++py)
+					{
+						const float* pRow{ pDepthBuffer + static_cast<size_t>(py) * width * samplesPerPixel };
+						for (int sample{ minX * samplesPerPixel }; sample < maxX * samplesPerPixel; ++sample)
+						{
+							//cleared pixels are not part of the range
+							const float depth{ pRow[sample] };
+							if (depth == FLT_MAX) continue;
+							minDepth = std::min(minDepth, depth);
+							maxDepth = std::max(maxDepth, depth);
+						}
+					}
+
+					const size_t tile{ static_cast<size_t>(tileY) * m_TilesX + tileX };
+					m_TileMinDepth[tile] = minDepth;
+					m_TileMaxDepth[tile] = maxDepth;
+				}
+			}
+		});
+}
+
+bool TiledLightCulling::ComputeLightBounds(const Light& light, const Camera& camera, int width, int height, LightBounds& bounds) const
+{
+	if (light.type == LightType::directional)
+	{
+		bounds = LightBounds{ 0, 0, m_TilesX - 1, m_TilesY - 1, -FLT_MAX, FLT_MAX };
+		return true;
+	}
+
+	//depth buffer holds z / w after the projection: P22 + P32 / viewDepth
+	const Matrix& projection{ camera.projectionMatrix };
+	const float depthScale{ projection[2].z };
+	const float depthOffset{ projection[3].z };
+	const float nearPlane{ -depthOffset / depthScale };
+	const auto toDepth = [&](float viewDepth) { return depthScale + depthOffset / viewDepth; };
+
+	//bounding sphere in view space (spots are bounded by their range too)
+	const Vector3 center{ camera.viewMatrix.TransformPoint(light.position) };
+	const float radius{ light.range };
+	if (center.z + radius <= nearPlane) return false;
+
+	const float minViewDepth{ center.z - radius };
+	const float maxViewDepth{ center.z + radius };
+	bounds.minDepth = minViewDepth <= nearPlane ? 0.f : toDepth(minViewDepth);
+	bounds.maxDepth = toDepth(maxViewDepth);
+
+	//project the corners of the view-space box around the sphere, a sphere reaching behind the near plane covers the whole screen
+	float minX{ 0.f }, minY{ 0.f }, maxX{ float(width) }, maxY{ float(height) };
+	if (minViewDepth > nearPlane)
+	{
+		minX = minY = FLT_MAX;
+		maxX = maxY = -FLT_MAX;
+		for (int corner{}; corner < 8; ++corner)
+		{
+			const Vector3 point{ center.x + ((corner & 1) ? radius : -radius), center.y + ((corner & 2) ? radius : -radius), center.z + ((corner & 4) ? radius : -radius) };
+			const Vector4 clip{ projection.TransformPoint(Vector4{ point.x, point.y, point.z, 1.f }) };
+			const float screenX{ (clip.x / clip.w + 1) / 2 * float(width) };
+			const float screenY{ (1 - clip.y / clip.w) / 2 * float(height) };
+			minX = std::min(minX, screenX);
+			maxX = std::max(maxX, screenX);
+			minY = std::min(minY, screenY);
+			maxY = std::max(maxY, screenY);
+		}
+	}
+
+	if (maxX < 0.f || maxY < 0.f || minX >= float(width) || minY >= float(height)) return false;
+
+	bounds.minTileX = std::max(static_cast<int>(minX), 0) / tileSize;
+	bounds.minTileY = std::max(static_cast<int>(minY), 0) / tileSize;
+	bounds.maxTileX = std::min(static_cast<int>(maxX), width - 1) / tileSize;
+	bounds.maxTileY = std::min(static_cast<int>(maxY), height - 1) / tileSize;
+	return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Camera.h"
+#include "Light.h"
+
+namespace dae
+{
+	class ThreadPool;
+
+	//Assigns lights to screen tiles once per frame, so a pixel only loops over the lights of its tile
+	//a point or spot light lands in a tile when its bounding sphere overlaps the tile on screen
+	//and the sphere's depth range overlaps the depth range of what was drawn in the tile (depth pre-pass)
+	//directional lights land in every tile
+	class TiledLightCulling final
+	{
+	public:
+		static constexpr int tileSize{ 16 };
+		//lights past this in one tile are dropped, see GetDroppedCount
+		static constexpr uint32_t maxLightsPerTile{ 64 };
+
+		struct TileLights
+		{
+			const uint16_t* pIndices{};
+			uint32_t count{};
+		};
+
+		//pDepthBuffer: depth of this frame (depth pre-pass), FLT_MAX where nothing was drawn
+		//samplesPerPixel depths per pixel next to each other (RenderTarget::sampleCount)
+		//only reallocates when the resolution changes
+		void Build(const std::vector<Light>& lights, const Camera& camera, const float* pDepthBuffer, int samplesPerPixel, int width, int height, ThreadPool& threadPool);
+
+		//indices into the light list Build got
+		TileLights GetTileLights(int pixelX, int pixelY) const
+		{
+			const size_t tile{ static_cast<size_t>(pixelY / tileSize) * m_TilesX + pixelX / tileSize };
+			return TileLights{ &m_TileLightIndices[tile * maxLightsPerTile], m_TileLightCounts[tile] };
+		}
+
+		int GetTileCount() const { return m_TilesX * m_TilesY; }
+		//summed over all tiles, last Build
+		uint32_t GetAssignmentCount() const { return m_AssignmentCount; }
+		uint32_t GetDroppedCount() const { return m_DroppedCount; }
+
+	private:
+		//tile rectangle (inclusive) and depth range in depth buffer units
+		struct LightBounds
+		{
+			int minTileX{}, minTileY{}, maxTileX{}, maxTileY{};
+			float minDepth{}, maxDepth{};
+		};
+
+		int m_TilesX{};
+		int m_TilesY{};
+		std::vector<float> m_TileMinDepth{};
+		std::vector<float> m_TileMaxDepth{};
+		//maxLightsPerTile slots per tile
+		std::vector<uint16_t> m_TileLightIndices{};
+		std::vector<uint32_t> m_TileLightCounts{};
+		std::vector<LightBounds> m_LightBounds{};
+		//lights with bounds on screen
+		std::vector<uint16_t> m_VisibleLights{};
+		uint32_t m_AssignmentCount{};
+		uint32_t m_DroppedCount{};
+
+		void ComputeTileDepthRanges(const float* pDepthBuffer, int samplesPerPixel, int width, int height, ThreadPool& threadPool);
+		bool ComputeLightBounds(const Light& light, const Camera& camera, int width, int height, LightBounds& bounds) const;
+	};
+}
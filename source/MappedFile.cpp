@@ -0,0 +1,69 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dae
+{
+#ifdef _WIN32
+	std::unique_ptr<MappedFile> MappedFile::Open(const std::string& path)
+	{
+		std::unique_ptr<MappedFile> pFile{ new MappedFile{} };
+
+		const HANDLE fileHandle{ CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+		if (fileHandle == INVALID_HANDLE_VALUE) return nullptr;
+		pFile->m_FileHandle = fileHandle;
+
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(fileHandle, &size) || size.QuadPart == 0) return nullptr;
+		pFile->m_Size = static_cast<size_t>(size.QuadPart);
+
+		pFile->m_MappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!pFile->m_MappingHandle) return nullptr;
+
+		pFile->m_pData = static_cast<const uint8_t*>(MapViewOfFile(pFile->m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+		if (!pFile->m_pData) return nullptr;
+
+		return pFile;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_pData) UnmapViewOfFile(m_pData);
+		if (m_MappingHandle) CloseHandle(m_MappingHandle);
+		if (m_FileHandle) CloseHandle(m_FileHandle);
+	}
+#else
+	std::unique_ptr<MappedFile> MappedFile::Open(const std::string& path)
+	{
+		std::unique_ptr<MappedFile> pFile{ new MappedFile{} };
+
+		pFile->m_FileDescriptor = open(path.c_str(), O_RDONLY);
+		if (pFile->m_FileDescriptor < 0) return nullptr;
+
+		struct stat fileStat{};
+		if (fstat(pFile->m_FileDescriptor, &fileStat) != 0 || fileStat.st_size == 0) return nullptr;
+		pFile->m_Size = static_cast<size_t>(fileStat.st_size);
+
+		void* pData{ mmap(nullptr, pFile->m_Size, PROT_READ, MAP_PRIVATE, pFile->m_FileDescriptor, 0) };
+		if (pData == MAP_FAILED) return nullptr;
+		pFile->m_pData = static_cast<const uint8_t*>(pData);
+
+		return pFile;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_pData) munmap(const_cast<uint8_t*>(m_pData), m_Size);
+		if (m_FileDescriptor >= 0) close(m_FileDescriptor);
+	}
+#endif
+}
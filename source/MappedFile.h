@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace dae
+{
+	//Read-only memory mapping of a whole file, the OS pages it in on first access
+	class MappedFile final
+	{
+	public:
+		//nullptr when the file does not exist or cannot be mapped
+		static std::unique_ptr<MappedFile> Open(const std::string& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) noexcept = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile& operator=(MappedFile&&) noexcept = delete;
+
+		//page aligned
+		const uint8_t* GetData() const { return m_pData; }
+		size_t GetSize() const { return m_Size; }
+
+	private:
+		MappedFile() = default;
+
+		const uint8_t* m_pData{ nullptr };
+		size_t m_Size{};
+
+#ifdef _WIN32
+		void* m_FileHandle{ nullptr };
+		void* m_MappingHandle{ nullptr };
+#else
+		int m_FileDescriptor{ -1 };
+#endif
+	};
+}
@@ -0,0 +1,32 @@
+#include "Material.h"
+
+#include <iostream>
+
+namespace dae
+{
+	PackedMaterial::PackedMaterial(std::unique_ptr<Texture> pDiffuseGloss, std::unique_ptr<Texture> pNormalSpecular) :
+		m_pDiffuseGloss{ std::move(pDiffuseGloss) },
+		m_pNormalSpecular{ std::move(pNormalSpecular) }
+	{
+	}
+
+	std::unique_ptr<PackedMaterial> PackedMaterial::Create(const Texture& diffuse, const Texture& normal, const Texture& gloss, const Texture& specular)
+	{
+		if (diffuse.GetFormat() != TextureFormat::bc1 || normal.GetFormat() != TextureFormat::bc5
+			|| gloss.GetFormat() != TextureFormat::bc4 || specular.GetFormat() != TextureFormat::bc1)
+		{
+			std::cout << "material maps are not block compressed as bc1, bc5, bc4, bc1, not packing them" << "\n";
+			return nullptr;
+		}
+
+		std::unique_ptr<Texture> pDiffuseGloss{ Texture::InterleaveBlocks(diffuse, gloss) };
+		std::unique_ptr<Texture> pNormalSpecular{ Texture::InterleaveBlocks(normal, specular) };
+		if (!pDiffuseGloss || !pNormalSpecular || pDiffuseGloss->GetWidth() != pNormalSpecular->GetWidth() || pDiffuseGloss->GetHeight() != pNormalSpecular->GetHeight())
+		{
+			std::cout << "material maps differ in size, not packing them" << "\n";
+			return nullptr;
+		}
+
+		return std::unique_ptr<PackedMaterial>{ new PackedMaterial{ std::move(pDiffuseGloss), std::move(pNormalSpecular) } };
+	}
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include <memory>
+#include "Texture.h"
+
+namespace dae
+{
+	//Everything PixelShading reads from the material textures, from a single Sample call
+	struct MaterialSample
+	{
+		ColorRGB diffuse{};
+		Vector3 tangentNormal{}; //decoded to [-1, 1]
+		float gloss{};
+		ColorRGB specular{};
+	};
+
+	//Bit mask of the MaterialSample members a shader reads, the others are not sampled and stay zero
+	namespace MaterialChannel
+	{
+		constexpr uint32_t diffuse{ 1 << 0 };
+		constexpr uint32_t normal{ 1 << 1 };
+		constexpr uint32_t gloss{ 1 << 2 };
+		constexpr uint32_t specular{ 1 << 3 };
+		constexpr uint32_t all{ diffuse | normal | gloss | specular };
+	}
+
+	//The block compressed diffuse, normal, gloss and specular maps interleaved block by block into two textures:
+	//diffuseGloss (bc1bc4): diffuse bc1 block, gloss bc4 block as alpha
+	//normalSpecular (bc5bc1): normal bc5 block (z is reconstructed), specular bc1 block
+	//the blocks are copied as they are, so it samples exactly like the separate maps and takes as much memory,
+	//with 2 fetches per pixel instead of 4
+	class PackedMaterial final
+	{
+	public:
+		//the maps have to be bc1 diffuse, bc5 normal, bc4 gloss and bc1 specular of the same size, returns nullptr otherwise
+		static std::unique_ptr<PackedMaterial> Create(const Texture& diffuse, const Texture& normal, const Texture& gloss, const Texture& specular);
+
+		//diffuseGloss is only fetched for the diffuse/gloss channels, normalSpecular for the normal/specular channels
+		template<uint32_t channels = MaterialChannel::all>
+		MaterialSample Sample(const Vector2& uv, TextureFilter filter, const UVDerivatives& derivatives) const;
+
+		size_t GetMemorySize() const { return m_pDiffuseGloss->GetMemorySize() + m_pNormalSpecular->GetMemorySize(); }
+
+	private:
+		PackedMaterial(std::unique_ptr<Texture> pDiffuseGloss, std::unique_ptr<Texture> pNormalSpecular);
+
+		std::unique_ptr<Texture> m_pDiffuseGloss{ nullptr };
+		std::unique_ptr<Texture> m_pNormalSpecular{ nullptr };
+
+		//normal x, y and specular r, g in [0, 1], specular b separately (5 channels, the texel has both blocks)
+		struct NormalSpecular
+		{
+			__m128 normalXYSpecularRG;
+			float specularB;
+		};
+		NormalSpecular FetchNormalSpecular(int level, int x, int y) const;
+		NormalSpecular SampleNormalSpecular(const Vector2& uv, int level, bool isPoint) const;
+	};
+
+	inline PackedMaterial::NormalSpecular PackedMaterial::FetchNormalSpecular(int level, int x, int y) const
+	{
+		const uint32_t* pBlock{ m_pNormalSpecular->GetLevelBlock(level, x >> 2, y >> 2) };
+		const int texelIndex{ ((y & 3) << 2) + (x & 3) };
+
+		const uint32_t normalX{ BlockCompression::DecodeBC4Value(pBlock, texelIndex) };
+		const uint32_t normalY{ BlockCompression::DecodeBC4Value(pBlock + BlockCompression::bc4BlockWords, texelIndex) };
+		const uint32_t specular{ BlockCompression::DecodeBC1Texel(pBlock + BlockCompression::bc5BlockWords, texelIndex) };
+
+		const __m128 colorRemap{ _mm_set1_ps(1 / 255.f) };
+		return NormalSpecular
+		{
+			_mm_mul_ps(_mm_set_ps(static_cast<float>((specular >> 8) & 0xff), static_cast<float>(specular & 0xff), static_cast<float>(normalY), static_cast<float>(normalX)), colorRemap),
+			((specular >> 16) & 0xff) * (1 / 255.f)
+		};
+	}
+
+	inline PackedMaterial::NormalSpecular PackedMaterial::SampleNormalSpecular(const Vector2& uv, int level, bool isPoint) const
+	{
+		const int width{ m_pNormalSpecular->GetLevelWidth(level) };
+		const int height{ m_pNormalSpecular->GetLevelHeight(level) };
+		if (isPoint)
+		{
+			return FetchNormalSpecular(level, Texture::Wrap(static_cast<int>(std::floor(uv.x * width)), width),
+				Texture::Wrap(static_cast<int>(std::floor(uv.y * height)), height));
+		}
+
+		const Texture::BilinearTexels texels{ Texture::LocateBilinear(uv, width, height) };
+		const NormalSpecular texel00{ FetchNormalSpecular(level, texels.x0, texels.y0) };
+		const NormalSpecular texel10{ FetchNormalSpecular(level, texels.x1, texels.y0) };
+		const NormalSpecular texel01{ FetchNormalSpecular(level, texels.x0, texels.y1) };
+		const NormalSpecular texel11{ FetchNormalSpecular(level, texels.x1, texels.y1) };
+
+		const __m128 fracX{ _mm_set1_ps(texels.fracX) };
+		const __m128 fracY{ _mm_set1_ps(texels.fracY) };
+		const __m128 top{ _mm_add_ps(texel00.normalXYSpecularRG, _mm_mul_ps(_mm_sub_ps(texel10.normalXYSpecularRG, texel00.normalXYSpecularRG), fracX)) };
+		const __m128 bottom{ _mm_add_ps(texel01.normalXYSpecularRG, _mm_mul_ps(_mm_sub_ps(texel11.normalXYSpecularRG, texel01.normalXYSpecularRG), fracX)) };
+
+		const float topB{ Lerpf(texel00.specularB, texel10.specularB, texels.fracX) };
+		const float bottomB{ Lerpf(texel01.specularB, texel11.specularB, texels.fracX) };
+
+		return NormalSpecular
+		{
+			_mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), fracY)),
+			Lerpf(topB, bottomB, texels.fracY)
+		};
+	}
+
+	template<uint32_t channels>
+	MaterialSample PackedMaterial::Sample(const Vector2& uv, TextureFilter filter, const UVDerivatives& derivatives) const
+	{
+		MaterialSample material{};
+
+		if constexpr ((channels & (MaterialChannel::diffuse | MaterialChannel::gloss)) != 0)
+		{
+			const Vector4 diffuseGloss{ m_pDiffuseGloss->SampleRGBA(uv, filter, derivatives) };
+			material.diffuse = ColorRGB{ diffuseGloss.x, diffuseGloss.y, diffuseGloss.z };
+			material.gloss = diffuseGloss.w;
+		}
+
+		if constexpr ((channels & (MaterialChannel::normal | MaterialChannel::specular)) != 0)
+		{
+			const Texture::MipSelection mip{ m_pNormalSpecular->SelectMip(filter, derivatives) };
+			const bool isPoint{ filter == TextureFilter::point };
+
+			NormalSpecular normalSpecular{ SampleNormalSpecular(uv, mip.level0, isPoint) };
+			if (mip.level0 != mip.level1 && mip.factor != 0.f)
+			{
+				const NormalSpecular sample1{ SampleNormalSpecular(uv, mip.level1, isPoint) };
+				normalSpecular.normalXYSpecularRG = _mm_add_ps(normalSpecular.normalXYSpecularRG,
+					_mm_mul_ps(_mm_sub_ps(sample1.normalXYSpecularRG, normalSpecular.normalXYSpecularRG), _mm_set1_ps(mip.factor)));
+				normalSpecular.specularB = Lerpf(normalSpecular.specularB, sample1.specularB, mip.factor);
+			}
+
+			alignas(16) float values[4];
+			_mm_store_ps(values, normalSpecular.normalXYSpecularRG);
+
+			const float x{ 2.f * values[0] - 1.f };
+			const float y{ 2.f * values[1] - 1.f };
+			const float zSquared{ 1.f - x * x - y * y };
+
+			material.tangentNormal = Vector3{ x, y, zSquared > 0.f ? std::sqrt(zSquared) : 0.f };
+			material.specular = ColorRGB{ values[2], values[3], normalSpecular.specularB };
+		}
+
+		return material;
+	}
+}
@@ -0,0 +1,58 @@
+#include "MeshBVH.h"
+
+#include <algorithm>
+
+using namespace dae;
+
+void MeshBVH::Build(const std::vector<Mesh>& meshes)
+{
+	m_WorldBounds.resize(meshes.size());
+	m_WorldSpheres.resize(meshes.size());
+	m_MeshIndices.clear();
+	for (size_t i{}; i < meshes.size(); ++i)
+	{
+		const Mesh& mesh{ meshes[i] };
+		if (mesh.vertices.empty()) continue;
+
+		m_WorldBounds[i] = mesh.bounds.Transformed(mesh.worldMatrix);
+		m_WorldSpheres[i] = mesh.boundingSphere.Transformed(mesh.worldMatrix);
+		m_MeshIndices.push_back(static_cast<uint32_t>(i));
+	}
+
+	//a binary tree with n leaves has 2n - 1 nodes, sized up front so BuildNode never reallocates
+	m_NodeCount = 0;
+	if (m_MeshIndices.empty()) return;
+	if (m_Nodes.size() < m_MeshIndices.size() * 2)
+	{
+		m_Nodes.resize(m_MeshIndices.size() * 2);
+	}
+	BuildNode(0, static_cast<uint32_t>(m_MeshIndices.size()));
+}
+
+uint32_t MeshBVH::BuildNode(uint32_t firstMesh, uint32_t meshCount)
+{
+	const uint32_t nodeIndex{ m_NodeCount++ };
+
+	BoundingBox bounds{};
+	BoundingBox centers{};
+	for (uint32_t i{ firstMesh }; i < firstMesh + meshCount; ++i)
+	{
+		const BoundingBox& meshBounds{ m_WorldBounds[m_MeshIndices[i]] };
+		bounds.Grow(meshBounds);
+		centers.Grow(meshBounds.GetCenter());
+	}
+	m_Nodes[nodeIndex] = Node{ bounds, firstMesh, meshCount, 0 };
+	if (meshCount <= maxLeafSize) return nodeIndex;
+
+	//median split along the axis the mesh centers spread the most on
+	const Vector3 spread{ centers.max - centers.min };
+	const int axis{ spread.x >= spread.y && spread.x >= spread.z ? 0 : (spread.y >= spread.z ? 1 : 2) };
+	const uint32_t firstCount{ meshCount / 2 };
+	std::nth_element(m_MeshIndices.begin() + firstMesh, m_MeshIndices.begin() + firstMesh + firstCount, m_MeshIndices.begin() + firstMesh + meshCount,
+		[this, axis](uint32_t a, uint32_t b) { return m_WorldBounds[a].GetCenter()[axis] < m_WorldBounds[b].GetCenter()[axis]; });
+
+	m_Nodes[nodeIndex].meshCount = 0;
+	BuildNode(firstMesh, firstCount);
+	m_Nodes[nodeIndex].secondChild = BuildNode(firstMesh + firstCount, meshCount - firstCount);
+	return nodeIndex;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Bounds.h"
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Bounding volume hierarchy over the world-space boxes of a mesh list, for frustum culling whole meshes
+	//rebuilt every frame since the meshes move, a subtree fully inside the frustum is taken without testing its meshes
+	class MeshBVH final
+	{
+	public:
+		static constexpr uint32_t maxLeafSize{ 4 };
+
+		//meshes without vertices are left out, only reallocates when the mesh count grows
+		void Build(const std::vector<Mesh>& meshes);
+
+		//calls visit(meshIndex) for every mesh that may be inside the frustum
+		template<typename Visit>
+		void ForEachVisible(const Frustum& frustum, Visit&& visit) const;
+
+		//meshes Build took in
+		uint32_t GetMeshCount() const { return static_cast<uint32_t>(m_MeshIndices.size()); }
+
+	private:
+		//a leaf holds meshCount meshes from firstMesh in m_MeshIndices, an inner node has meshCount 0,
+		//its first child right after it and the second one at secondChild
+		struct Node
+		{
+			BoundingBox bounds;
+			uint32_t firstMesh;
+			uint32_t meshCount;
+			uint32_t secondChild;
+		};
+
+		uint32_t BuildNode(uint32_t firstMesh, uint32_t meshCount);
+
+		std::vector<Node> m_Nodes{};
+		uint32_t m_NodeCount{};
+		std::vector<uint32_t> m_MeshIndices{};
+		//per mesh index
+		std::vector<BoundingBox> m_WorldBounds{};
+		std::vector<BoundingSphere> m_WorldSpheres{};
+	};
+
+	template<typename Visit>
+	void MeshBVH::ForEachVisible(const Frustum& frustum, Visit&& visit) const
+	{
+		if (m_NodeCount == 0) return;
+
+		//median splits keep the depth at about log2 of the mesh count
+		struct StackEntry
+		{
+			uint32_t node;
+			bool isInside;
+		};
+		StackEntry stack[64];
+		int stackSize{};
+		stack[stackSize++] = StackEntry{ 0, false };
+
+		while (stackSize > 0)
+		{
+			const StackEntry entry{ stack[--stackSize] };
+			const Node& node{ m_Nodes[entry.node] };
+
+			bool isInside{ entry.isInside };
+			if (!isInside)
+			{
+				const Containment containment{ frustum.Classify(node.bounds) };
+				if (containment == Containment::outside) continue;
+				isInside = containment == Containment::inside;
+			}
+
+			if (node.meshCount == 0)
+			{
+				stack[stackSize++] = StackEntry{ node.secondChild, isInside };
+				stack[stackSize++] = StackEntry{ entry.node + 1, isInside };
+				continue;
+			}
+
+			for (uint32_t i{ node.firstMesh }; i < node.firstMesh + node.meshCount; ++i)
+			{
+				const uint32_t meshIndex{ m_MeshIndices[i] };
+				//the sphere is the cheaper test, the box the tighter one
+				if (!isInside && (frustum.IsOutside(m_WorldSpheres[meshIndex]) || frustum.Classify(m_WorldBounds[meshIndex]) == Containment::outside)) continue;
+				visit(static_cast<size_t>(meshIndex));
+			}
+		}
+	}
+}
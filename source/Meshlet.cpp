@@ -0,0 +1,184 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include "DataTypes.h"
+
+using namespace dae;
+
+namespace
+{
+	//sphere and normal cone of the meshlet's vertices and triangles
+	void ComputeMeshletBounds(Meshlet& meshlet, const std::vector<Vertex>& meshletVertices, const std::vector<uint8_t>& meshletTriangles)
+	{
+		const Vertex* pVertices{ meshletVertices.data() + meshlet.vertexOffset };
+		const uint8_t* pTriangles{ meshletTriangles.data() + meshlet.triangleOffset * 3 };
+
+		BoundingBox box{};
+		for (uint32_t i{}; i < meshlet.vertexCount; ++i)
+		{
+			box.Grow(pVertices[i].position);
+		}
+		meshlet.boundingSphere = BoundingSphere{ box.GetCenter(), 0.f };
+		for (uint32_t i{}; i < meshlet.vertexCount; ++i)
+		{
+			meshlet.boundingSphere.radius = std::max(meshlet.boundingSphere.radius, (pVertices[i].position - box.GetCenter()).Magnitude());
+		}
+
+		//face normals from the winding, turned to the side the vertex normals point to
+		//(the rasterizer draws both windings, so the winding alone does not say which side is the front)
+		Vector3 normals[Meshlet::maxTriangles]{};
+		Vector3 normalSum{};
+		for (uint32_t t{}; t < meshlet.triangleCount; ++t)
+		{
+			const Vertex& v0{ pVertices[pTriangles[t * 3]] };
+			const Vertex& v1{ pVertices[pTriangles[t * 3 + 1]] };
+			const Vertex& v2{ pVertices[pTriangles[t * 3 + 2]] };
+
+			Vector3 normal{ Vector3::Cross(v1.position - v0.position, v2.position - v0.position) };
+			if (normal.SqrMagnitude() <= FLT_EPSILON * FLT_EPSILON) continue;
+			normal.Normalize();
+			const float side{ Vector3::Dot(normal, v0.normal + v1.normal + v2.normal) };
+			//no vertex normals to tell the front: leave the meshlet to the frustum test
+			if (side == 0.f) return;
+			if (side < 0.f) normal = -normal;
+
+			normals[t] = normal;
+			normalSum += normal;
+		}
+
+		if (normalSum.SqrMagnitude() <= FLT_EPSILON) return;
+		meshlet.coneAxis = normalSum.Normalized();
+		meshlet.coneCos = 1.f;
+		for (uint32_t t{}; t < meshlet.triangleCount; ++t)
+		{
+			//degenerate triangles have no normal and can't be seen anyway
+			if (normals[t].SqrMagnitude() == 0.f) continue;
+			meshlet.coneCos = std::min(meshlet.coneCos, Vector3::Dot(normals[t], meshlet.coneAxis));
+		}
+		meshlet.coneSin = sqrtf(std::max(1.f - meshlet.coneCos * meshlet.coneCos, 0.f));
+	}
+
+	//every edge shared by exactly two triangles, edges between positions so seams (vertices split for uv or normals) still count as closed
+	bool IsClosedSurface(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& triangleIndices)
+	{
+		if (triangleIndices.empty()) return false;
+
+		struct PositionHash
+		{
+			size_t operator()(const Vector3& position) const
+			{
+				uint32_t bits[3]{};
+				std::memcpy(bits, &position, sizeof(bits));
+				return (static_cast<size_t>(bits[0]) * 73856093) ^ (static_cast<size_t>(bits[1]) * 19349663) ^ (static_cast<size_t>(bits[2]) * 83492791);
+			}
+		};
+		struct PositionEqual
+		{
+			bool operator()(const Vector3& a, const Vector3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+		};
+
+		std::unordered_map<Vector3, uint32_t, PositionHash, PositionEqual> positionIds{};
+		std::vector<uint32_t> vertexPositionIds(vertices.size());
+		for (size_t i{}; i < vertices.size(); ++i)
+		{
+			vertexPositionIds[i] = positionIds.emplace(vertices[i].position, static_cast<uint32_t>(positionIds.size())).first->second;
+		}
+
+		std::unordered_map<uint64_t, uint32_t> edgeUses{};
+		for (size_t i{}; i < triangleIndices.size(); i += 3)
+		{
+			const uint32_t ids[3]{ vertexPositionIds[triangleIndices[i]], vertexPositionIds[triangleIndices[i + 1]], vertexPositionIds[triangleIndices[i + 2]] };
+			//collapsed by the weld (poles of a uv sphere): no area, nothing to close
+			if (ids[0] == ids[1] || ids[1] == ids[2] || ids[0] == ids[2]) continue;
+
+			for (int edge{}; edge < 3; ++edge)
+			{
+				const uint32_t a{ ids[edge] };
+				const uint32_t b{ ids[(edge + 1) % 3] };
+				++edgeUses[static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b)];
+			}
+		}
+		if (edgeUses.empty()) return false;
+		return std::all_of(edgeUses.begin(), edgeUses.end(), [](const auto& edge) { return edge.second == 2; });
+	}
+}
+
+void Mesh::BuildMeshlets()
+{
+	meshlets.clear();
+	meshletTriangles.clear();
+
+	//triangles in index order, strips unrolled with the odd triangles turned back like the rasterizer does
+	//vertices that are next to each other in the index buffer usually are next to each other on the mesh too
+	const bool isList{ primitiveTopology == PrimitiveTopology::TriangleList };
+	const size_t triangleCount{ isList ? indices.size() / 3 : (indices.size() >= 3 ? indices.size() - 2 : 0) };
+
+	//vertices shared between meshlets are copied into each of them
+	std::vector<Vertex> meshletVertices{};
+	meshletVertices.reserve(vertices.size() + vertices.size() / 2);
+	//slot of a mesh vertex in the meshlet being filled, -1 when it is not in it
+	std::vector<int> localIndices(vertices.size(), -1);
+	uint32_t meshVertexIndices[Meshlet::maxVertices]{};
+	Meshlet meshlet{};
+	//the unrolled triangles with mesh vertex indices, for isClosed
+	std::vector<uint32_t> triangleIndices{};
+	triangleIndices.reserve(triangleCount * 3);
+
+	const auto finishMeshlet = [&]()
+	{
+		if (meshlet.triangleCount == 0) return;
+
+		ComputeMeshletBounds(meshlet, meshletVertices, meshletTriangles);
+		meshlets.push_back(meshlet);
+
+		for (uint32_t i{}; i < meshlet.vertexCount; ++i)
+		{
+			localIndices[meshVertexIndices[i]] = -1;
+		}
+		//the next meshlet starts on a SIMD batch, padded with copies of the last vertex
+		while (meshletVertices.size() % 4 != 0)
+		{
+			meshletVertices.push_back(meshletVertices.back());
+		}
+		meshlet = Meshlet{ static_cast<uint32_t>(meshletVertices.size()), 0, static_cast<uint32_t>(meshletTriangles.size() / 3), 0 };
+	};
+
+	for (size_t t{}; t < triangleCount; ++t)
+	{
+		const bool isOdd{ !isList && (t & 1) != 0 };
+		const size_t first{ isList ? t * 3 : t };
+		const uint32_t triangle[3]{ indices[first], indices[isOdd ? first + 2 : first + 1], indices[isOdd ? first + 1 : first + 2] };
+		//strips restart with repeated indices
+		if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) continue;
+		triangleIndices.insert(triangleIndices.end(), triangle, triangle + 3);
+
+		uint32_t newVertexCount{};
+		for (uint32_t index : triangle)
+		{
+			if (localIndices[index] < 0) ++newVertexCount;
+		}
+		if (meshlet.vertexCount + newVertexCount > Meshlet::maxVertices || meshlet.triangleCount == Meshlet::maxTriangles)
+		{
+			finishMeshlet();
+		}
+
+		for (uint32_t index : triangle)
+		{
+			if (localIndices[index] < 0)
+			{
+				localIndices[index] = static_cast<int>(meshlet.vertexCount);
+				meshVertexIndices[meshlet.vertexCount++] = index;
+				meshletVertices.push_back(vertices[index]);
+			}
+			meshletTriangles.push_back(static_cast<uint8_t>(localIndices[index]));
+		}
+		++meshlet.triangleCount;
+	}
+	finishMeshlet();
+
+	meshletVerticesSoA.Build(meshletVertices);
+	isClosed = IsClosedSurface(vertices, triangleIndices);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "Bounds.h"
+#include "Math.h"
+
+namespace dae
+{
+	//Cluster of up to maxVertices vertices and maxTriangles triangles of a mesh, built at load (Mesh::BuildMeshlets)
+	//culled as a whole before its vertices are transformed, and the unit the vertex stage is split into across threads
+	struct Meshlet
+	{
+		static constexpr uint32_t maxVertices{ 64 };
+		static constexpr uint32_t maxTriangles{ 124 };
+
+		//vertices [vertexOffset, vertexOffset + vertexCount) of Mesh::meshletVerticesSoA, vertexOffset is a multiple of 4
+		uint32_t vertexOffset{};
+		uint32_t vertexCount{};
+		//triangles [triangleOffset, triangleOffset + triangleCount) of Mesh::meshletTriangles, 3 indices each relative to vertexOffset
+		uint32_t triangleOffset{};
+		uint32_t triangleCount{};
+
+		//object space
+		BoundingSphere boundingSphere{};
+		//every triangle normal lies within the cone angle around coneAxis
+		//coneCos <= 0: the triangles face too many ways to ever all face away
+		Vector3 coneAxis{};
+		float coneCos{ -1.f };
+		float coneSin{};
+	};
+
+	//Meshlet tests of one draw, in object space of the mesh so the meshlet bounds are used as they are
+	//the pipeline draws both windings, so a meshlet facing away is only hidden when the mesh is closed
+	//and the camera is outside of it, the normal cones are only tested then
+	struct MeshletCulling
+	{
+		Frustum frustum{};
+		Vector3 cameraPosition{};
+		bool useNormalCones{};
+		//added up by every DrawMesh this is passed to
+		uint32_t testedCount{};
+		uint32_t culledCount{};
+
+		//isClosedMesh, meshBounds: Mesh::isClosed, Mesh::bounds
+		static MeshletCulling Create(const Matrix& world, const Matrix& viewProjection, const Vector3& cameraOrigin, bool isClosedMesh, const BoundingBox& meshBounds)
+		{
+			const Vector3 cameraPosition{ Matrix::Inverse(world).TransformPoint(cameraOrigin) };
+			return MeshletCulling{ Frustum::FromViewProjection(world * viewProjection), cameraPosition, isClosedMesh && !meshBounds.Contains(cameraPosition) };
+		}
+
+		//outside the frustum, or (useNormalCones) every triangle faces away from the camera
+		bool IsCulled(const Meshlet& meshlet) const
+		{
+			const BoundingSphere& sphere{ meshlet.boundingSphere };
+			if (frustum.IsOutside(sphere)) return true;
+			if (!useNormalCones || meshlet.coneCos <= 0.f) return false;
+
+			//facing away: Dot(normal, p - camera) > 0 for every normal in the cone and every p in the sphere,
+			//which holds when |v| * cos(angle(v, coneAxis) + cone angle) > radius, v from the camera to the center
+			const Vector3 toCenter{ sphere.center - cameraPosition };
+			const float distance{ toCenter.Magnitude() };
+			if (distance <= sphere.radius) return false;
+
+			const float cosAngle{ Vector3::Dot(toCenter, meshlet.coneAxis) / distance };
+			const float sinAngle{ sqrtf(std::max(1.f - cosAngle * cosAngle, 0.f)) };
+			return distance * (cosAngle * meshlet.coneCos - sinAngle * meshlet.coneSin) > sphere.radius;
+		}
+	};
+}
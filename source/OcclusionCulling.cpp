@@ -0,0 +1,108 @@
+#include "OcclusionCulling.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#include "ThreadPool.h"
+
+using namespace dae;
+
+void OcclusionCuller::Reset(int width, int height)
+{
+	m_Width = width;
+	m_Height = height;
+	m_TilesX = (width + tileSize - 1) / tileSize;
+	m_TilesY = (height + tileSize - 1) / tileSize;
+
+	const size_t tileCount{ static_cast<size_t>(m_TilesX) * m_TilesY };
+	if (m_TileMaxDepth.size() != tileCount)
+	{
+		m_TileMaxDepth.resize(tileCount);
+	}
+	std::fill(m_TileMaxDepth.begin(), m_TileMaxDepth.end(), FLT_MAX);
+}
+
+OcclusionCuller::ScreenBounds OcclusionCuller::ProjectBox(const BoundingBox& box, const Matrix& worldViewProjection) const
+{
+	float minX{ FLT_MAX }, minY{ FLT_MAX }, maxX{ -FLT_MAX }, maxY{ -FLT_MAX };
+	float nearestDepth{ FLT_MAX };
+	for (int corner{}; corner < 8; ++corner)
+	{
+		const Vector4 clip{ worldViewProjection.TransformPoint(box.GetCorner(corner).ToPoint4()) };
+
+		//in front of the near plane it is not a rectangle anymore
+		if (clip.z < 0.f || clip.w <= 0.f)
+		{
+			return ScreenBounds{ 0, 0, m_Width - 1, m_Height - 1, 0.f };
+		}
+
+		const float invW{ 1.f / clip.w };
+		const float screenX{ (clip.x * invW + 1) / 2 * float(m_Width) };
+		const float screenY{ (1 - clip.y * invW) / 2 * float(m_Height) };
+		minX = std::min(minX, screenX);
+		maxX = std::max(maxX, screenX);
+		minY = std::min(minY, screenY);
+		maxY = std::max(maxY, screenY);
+		nearestDepth = std::min(nearestDepth, clip.z * invW);
+	}
+
+	//off screen the rectangle ends up empty (ScreenBounds::IsOffScreen)
+	return ScreenBounds
+	{
+		std::max(static_cast<int>(minX), 0), std::max(static_cast<int>(minY), 0),
+		std::min(static_cast<int>(maxX), m_Width - 1), std::min(static_cast<int>(maxY), m_Height - 1),
+		nearestDepth
+	};
+}
+
+bool OcclusionCuller::IsOccluded(const ScreenBounds& bounds) const
+{
+	//nothing of it is on screen, so nothing to draw either (not counted as occluded by the renderer, see FrameStats)
+	if (bounds.IsOffScreen()) return true;
+
+	for (int tileY{ bounds.minY / tileSize }; tileY <= bounds.maxY / tileSize; ++tileY)
+	{
+		const float* pRow{ &m_TileMaxDepth[static_cast<size_t>(tileY) * m_TilesX] };
+		for (int tileX{ bounds.minX / tileSize }; tileX <= bounds.maxX / tileSize; ++tileX)
+		{
+			if (bounds.nearestDepth <= pRow[tileX]) return false;
+		}
+	}
+	return true;
+}
+
+void OcclusionCuller::Update(const ScreenBounds& bounds, const float* pDepthBuffer, int samplesPerPixel, ThreadPool& threadPool)
+{
+	if (bounds.IsOffScreen()) return;
+
+	const int minTileX{ bounds.minX / tileSize };
+	const int maxTileX{ bounds.maxX / tileSize };
+	const int minTileY{ bounds.minY / tileSize };
+	const int maxTileY{ bounds.maxY / tileSize };
+
+	//one tile row per chunk, every tile is recomputed over all its pixels (the tile can be wider than the rectangle)
+	threadPool.ParallelFor(static_cast<size_t>(maxTileY - minTileY + 1), 1, [&](size_t begin, size_t end)
+		{
+			for (int tileY{ minTileY + static_cast<int>(begin) }; tileY < minTileY + static_cast<int>(end); ++tileY)
+			{
+				const int minY{ tileY * tileSize };
+				const int maxY{ std::min(minY + tileSize, m_Height) };
+				for (int tileX{ minTileX }; tileX <= maxTileX; ++tileX)
+				{
+					const int minX{ tileX * tileSize };
+					const int maxX{ std::min(minX + tileSize, m_Width) };
+
+					float maxDepth{ -FLT_MAX };
+					for (int py{ minY }; py < maxY; ++py)
+					{
+						const float* pRow{ pDepthBuffer + static_cast<size_t>(py) * m_Width * samplesPerPixel };
+						for (int sample{ minX * samplesPerPixel }; sample < maxX * samplesPerPixel; ++sample)
+						{
+							maxDepth = std::max(maxDepth, pRow[sample]);
+						}
+					}
+					m_TileMaxDepth[static_cast<size_t>(tileY) * m_TilesX + tileX] = maxDepth;
+				}
+			}
+		});
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Bounds.h"
+#include "Math.h"
+
+namespace dae
+{
+	class ThreadPool;
+
+	//Whole-mesh occlusion test against a coarse max-depth buffer of what was drawn so far this frame
+	//every tile holds the farthest depth in it (FLT_MAX while a pixel of it is still empty),
+	//a mesh is hidden when its nearest point lies behind that in every tile its screen rectangle covers
+	//draw front to back and Update after every mesh, so the meshes drawn first occlude the ones after them
+	class OcclusionCuller final
+	{
+	public:
+		static constexpr int tileSize{ 8 };
+
+		//pixel rectangle (inclusive) and nearest depth (depth buffer units) of a mesh
+		struct ScreenBounds
+		{
+			int minX{}, minY{}, maxX{}, maxY{};
+			float nearestDepth{};
+
+			//ProjectBox leaves the rectangle empty (min > max) when the box is off screen
+			bool IsOffScreen() const { return minX > maxX || minY > maxY; }
+		};
+
+		//nothing occludes after this, only reallocates when the size changes
+		void Reset(int width, int height);
+
+		//screen bounds of the object-space box, conservative: a box reaching behind the near plane covers the whole screen at depth 0
+		ScreenBounds ProjectBox(const BoundingBox& box, const Matrix& worldViewProjection) const;
+		bool IsOccluded(const ScreenBounds& bounds) const;
+
+		//re-reads the tiles under bounds after the mesh was drawn into pDepthBuffer
+		//samplesPerPixel depths per pixel next to each other (RenderTarget::sampleCount)
+		void Update(const ScreenBounds& bounds, const float* pDepthBuffer, int samplesPerPixel, ThreadPool& threadPool);
+
+	private:
+		int m_Width{};
+		int m_Height{};
+		int m_TilesX{};
+		int m_TilesY{};
+		std::vector<float> m_TileMaxDepth{};
+	};
+}
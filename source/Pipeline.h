@@ -0,0 +1,601 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <immintrin.h>
+#include <type_traits>
+#include <SDL_pixels.h>
+
+#include "DataTypes.h"
+#include "FrameArena.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+
+namespace dae
+{
+	//Color + depth buffer the pipeline draws into, depth is cleared to FLT_MAX
+	//sampleCount 4 (4x MSAA): pDepthBuffer holds the 4 sample depths of a pixel next to each other,
+	//the shaded color goes to the 4 samples in pSampleColorBuffer (PackSampleColor) until ResolveMultisample writes pColorBuffer
+	struct RenderTarget
+	{
+		uint32_t* pColorBuffer{};
+		float* pDepthBuffer{};
+		int width{};
+		int height{};
+		const SDL_PixelFormat* pFormat{};
+		int sampleCount{ 1 };
+		uint32_t* pSampleColorBuffer{};
+	};
+
+	inline uint32_t PackSampleColor(uint8_t r, uint8_t g, uint8_t b)
+	{
+		return uint32_t(r) | uint32_t(g) << 8 | uint32_t(b) << 16;
+	}
+
+	//Averages the 4 samples of every pixel into pColorBuffer
+	void ResolveMultisample(const RenderTarget& target, ThreadPool& threadPool);
+
+	//Stretches source.pColorBuffer over destination.pColorBuffer with a bilinear filter
+	//blends every byte of a pixel on its own, so it works for any 32 bit format with 8 bit channels
+	void UpscaleBilinear(const RenderTarget& source, const RenderTarget& destination, ThreadPool& threadPool);
+
+	//less: the usual test
+	//lessEqual: for shading after a depth pre-pass (DrawMeshDepth) of the same mesh, only the visible pixels get shaded
+	//the pre-pass has to output the exact same positions (same vertex kernel), or pixels fail the equal test
+	enum class DepthTest
+	{
+		less, lessEqual
+	};
+
+	//how many pixels share one pixel shader call (width x height), coverage and depth stay per pixel (per sample with MSAA)
+	enum class ShadingRate
+	{
+		rate1x1, rate2x1, rate1x2, rate2x2
+	};
+
+	//The shading rate of a draw: one rate for the whole draw (per material),
+	//or a second one for the periphery of the screen, outside an ellipse around the center
+	struct ShadingRateSettings
+	{
+		ShadingRate center{ ShadingRate::rate1x1 };
+		ShadingRate periphery{ ShadingRate::rate1x1 };
+		//radius of the ellipse in half screen sizes, 1 touches the screen edges
+		float peripheryStart{ 1.f };
+
+		bool IsFullRate() const { return center == ShadingRate::rate1x1 && periphery == ShadingRate::rate1x1; }
+
+		//for the 2x2 pixel quad starting at (quadX, quadY)
+		ShadingRate GetRate(int quadX, int quadY, int width, int height) const
+		{
+			if (center == periphery) return center;
+			const float x{ (float(quadX) + 1.f) / float(width) * 2.f - 1.f };
+			const float y{ (float(quadY) + 1.f) / float(height) * 2.f - 1.f };
+			return x * x + y * y >= peripheryStart * peripheryStart ? periphery : center;
+		}
+
+		static int GetWidth(ShadingRate rate) { return rate == ShadingRate::rate2x1 || rate == ShadingRate::rate2x2 ? 2 : 1; }
+		static int GetHeight(ShadingRate rate) { return rate == ShadingRate::rate1x2 || rate == ShadingRate::rate2x2 ? 2 : 1; }
+	};
+
+	//screen-space gradients (d/dx, d/dy) of u/w, v/w and 1/w over one triangle
+	struct TriangleUVGradients
+	{
+		Vector2 uOverW{};
+		Vector2 vOverW{};
+		Vector2 oneOverW{};
+
+		//positions in screen space, w is still the view depth
+		static TriangleUVGradients Compute(const Vector4& position0, const Vector4& position1, const Vector4& position2,
+			const Vector2& uv0, const Vector2& uv1, const Vector2& uv2);
+		UVDerivatives GetDerivatives(const Vector2& uv, float interpolatedW) const;
+	};
+
+	//Software rasterization pipeline, the shaders are compile-time policies that get inlined into the loops
+	//(no virtual calls or std::function per vertex or pixel)
+	//
+	//VertexShader:
+	//	using Varying = ...;
+	//	void ShadeVertices(const VertexStreamSoA& stream, size_t begin, size_t end, Varying* pOut) const;
+	//		transforms [begin, end) into pOut[begin, end), begin is a multiple of 4, called from several threads at once
+	//		stream is Mesh::meshletVerticesSoA, [begin, end) covers one or more whole meshlets
+	//		Varying::position: x, y in NDC, z = depth, w = view depth (perspective divide done, w kept)
+	//Varying (usually dae::Varying<attributes>, see Varying.h):
+	//	Vector4 position; Vector2 uv (only read when Varying::Has(VaryingAttribute::uv))
+	//	static constexpr bool Has(uint32_t attribute);
+	//	static Varying Interpolate(const Varying& v0, const Varying& v1, const Varying& v2, float weight0, float weight1, float weight2);
+	//		blends every attribute but position, the weights are already perspective-correct
+	//		the pipeline sets position to (pixel center x, y, depth, view depth) afterwards
+	//PixelShader:
+	//	bool NeedsUVDerivatives() const; asked once per draw
+	//	ColorRGB Shade(const Varying& v, const UVDerivatives& uvDerivatives) const;
+	//
+	//pMeshletCulling: meshlets outside the frustum or facing away are skipped before the vertex stage, nullptr draws every meshlet
+	template<typename VertexShader, typename PixelShader>
+	void DrawMesh(const Mesh& mesh, const VertexShader& vertexShader, const PixelShader& pixelShader,
+		const RenderTarget& target, FrameArena& frameArena, ThreadPool& threadPool, DepthTest depthTest = DepthTest::less,
+		const ShadingRateSettings& shadingRate = {}, MeshletCulling* pMeshletCulling = nullptr);
+
+	//Pixel shader for DrawMeshDepth, the raster loop stops after the depth write
+	struct DepthOnlyPixelShader
+	{
+		bool NeedsUVDerivatives() const { return false; }
+		//never called
+		template<typename Varying>
+		ColorRGB Shade(const Varying&, const UVDerivatives&) const { return {}; }
+	};
+
+	//Fills target.pDepthBuffer only, the color buffer is left alone
+	//the vertex shader only needs to output position (e.g. VehicleVertexShader<0>)
+	template<typename VertexShader>
+	void DrawMeshDepth(const Mesh& mesh, const VertexShader& vertexShader, const RenderTarget& target, FrameArena& frameArena, ThreadPool& threadPool,
+		MeshletCulling* pMeshletCulling = nullptr)
+	{
+		DrawMesh(mesh, vertexShader, DepthOnlyPixelShader{}, target, frameArena, threadPool, DepthTest::less, {}, pMeshletCulling);
+	}
+
+	namespace PipelineDetail
+	{
+		inline bool IsOutsideFrustum(const Vector4& v0, const Vector4& v1, const Vector4& v2)
+		{
+			const auto isOutside = [](const Vector4& v)
+			{
+				return v.x < -1 || v.x > 1 || v.y < -1 || v.y > 1 || v.z < 0 || v.z > 1;
+			};
+			return isOutside(v0) || isOutside(v1) || isOutside(v2);
+		}
+
+		inline void ToScreenSpace(Vector4& v, int width, int height)
+		{
+			v.x = (v.x + 1) / 2 * float(width);
+			v.y = (1 - v.y) / 2 * float(height);
+		}
+
+		//4x MSAA: the same edge functions and 1/z, evaluated at the 4 sample positions of a pixel in one SSE op each
+		//rotated grid, the standard D3D pattern
+		struct SampleCoverage
+		{
+			__m128 edgeX[3]{};
+			__m128 edgeY[3]{};
+			__m128 edgeC[3]{};
+			__m128 invZ[3]{};
+
+			//weight i = Cross(vec(i + 2) - vec(i + 1), p - vec(i + 1)) * invArea, written as edgeX * x + edgeY * y + edgeC
+			static SampleCoverage Setup(const Vector2 (&vec)[3], float invArea, const float (&invZs)[3])
+			{
+				SampleCoverage coverage{};
+				for (int i{}; i < 3; ++i)
+				{
+					const Vector2& from{ vec[(i + 1) % 3] };
+					const Vector2 edge{ vec[(i + 2) % 3] - from };
+					const float x{ -edge.y * invArea };
+					const float y{ edge.x * invArea };
+					coverage.edgeX[i] = _mm_set1_ps(x);
+					coverage.edgeY[i] = _mm_set1_ps(y);
+					coverage.edgeC[i] = _mm_set1_ps(-(x * from.x + y * from.y));
+					coverage.invZ[i] = _mm_set1_ps(invZs[i]);
+				}
+				return coverage;
+			}
+
+			//bit i: sample i is inside and passed the depth test, the depth of those samples is written
+			int TestAndWriteDepth(int px, int py, float* pSampleDepth, DepthTest depthTest) const
+			{
+				const __m128 sampleX{ _mm_add_ps(_mm_set1_ps(float(px)), _mm_setr_ps(0.375f, 0.875f, 0.125f, 0.625f)) };
+				const __m128 sampleY{ _mm_add_ps(_mm_set1_ps(float(py)), _mm_setr_ps(0.125f, 0.375f, 0.625f, 0.875f)) };
+				const __m128 zero{ _mm_setzero_ps() };
+
+				__m128 weights[3];
+				__m128 inside{ _mm_castsi128_ps(_mm_set1_epi32(-1)) };
+				for (int i{}; i < 3; ++i)
+				{
+					weights[i] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeX[i], sampleX), _mm_mul_ps(edgeY[i], sampleY)), edgeC[i]);
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(weights[i], zero));
+				}
+				if (_mm_movemask_ps(inside) == 0) return 0;
+
+				const __m128 sumInvZ{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(invZ[0], weights[0]), _mm_mul_ps(invZ[1], weights[1])), _mm_mul_ps(invZ[2], weights[2])) };
+				const __m128 depth{ _mm_div_ps(_mm_set1_ps(1.f), sumInvZ) };
+				const __m128 stored{ _mm_loadu_ps(pSampleDepth) };
+				const __m128 pass{ _mm_and_ps(inside, depthTest == DepthTest::less ? _mm_cmplt_ps(depth, stored) : _mm_cmple_ps(depth, stored)) };
+				_mm_storeu_ps(pSampleDepth, _mm_or_ps(_mm_and_ps(pass, depth), _mm_andnot_ps(pass, stored)));
+				return _mm_movemask_ps(pass);
+			}
+		};
+
+		template<int sampleCount, typename Varying, typename PixelShader>
+		void RasterizeTriangle(Varying v0, Varying v1, Varying v2, const PixelShader& pixelShader, bool needsUVDerivatives, DepthTest depthTest,
+			const ShadingRateSettings& shadingRate, const RenderTarget& target)
+		{
+			//frustum culling
+			if (IsOutsideFrustum(v0.position, v1.position, v2.position)) return;
+
+			ToScreenSpace(v0.position, target.width, target.height);
+			ToScreenSpace(v1.position, target.width, target.height);
+			ToScreenSpace(v2.position, target.width, target.height);
+
+			const Vector2 vec0{ v0.position.x, v0.position.y };
+			const Vector2 vec1{ v1.position.x, v1.position.y };
+			const Vector2 vec2{ v2.position.x, v2.position.y };
+
+			//both windings are drawn, the weights are positive inside either way
+			const float area{ Vector2::Cross(vec1 - vec0, vec2 - vec0) };
+			if (area == 0.f) return;
+			const float invArea{ 1.f / area };
+
+			//bounding box, clamped to the target
+			const int minX{ std::clamp(static_cast<int>(std::min({ vec0.x, vec1.x, vec2.x })), 0, target.width - 1) };
+			const int minY{ std::clamp(static_cast<int>(std::min({ vec0.y, vec1.y, vec2.y })), 0, target.height - 1) };
+			const int maxX{ std::clamp(static_cast<int>(std::max({ vec0.x, vec1.x, vec2.x })), 0, target.width - 1) };
+			const int maxY{ std::clamp(static_cast<int>(std::max({ vec0.y, vec1.y, vec2.y })), 0, target.height - 1) };
+
+			//screen-space gradients of uv/w and 1/w, both are linear over the triangle
+			TriangleUVGradients uvGradients{};
+			if constexpr (Varying::Has(VaryingAttribute::uv))
+			{
+				if (needsUVDerivatives)
+					uvGradients = TriangleUVGradients::Compute(v0.position, v1.position, v2.position, v0.uv, v1.uv, v2.uv);
+			}
+
+			const float invZ0{ 1.f / v0.position.z };
+			const float invZ1{ 1.f / v1.position.z };
+			const float invZ2{ 1.f / v2.position.z };
+			const float invW0{ 1.f / v0.position.w };
+			const float invW1{ 1.f / v1.position.w };
+			const float invW2{ 1.f / v2.position.w };
+
+			SampleCoverage sampleCoverage{};
+			if constexpr (sampleCount == 4)
+			{
+				sampleCoverage = SampleCoverage::Setup({ vec0, vec1, vec2 }, invArea, { invZ0, invZ1, invZ2 });
+			}
+
+			const auto computeWeights = [&](const Vector2& point, float& weight0, float& weight1, float& weight2)
+			{
+				weight0 = Vector2::Cross(vec2 - vec1, point - vec1) * invArea;
+				weight1 = Vector2::Cross(vec0 - vec2, point - vec2) * invArea;
+				weight2 = Vector2::Cross(vec1 - vec0, point - vec0) * invArea;
+			};
+
+			//runs the pixel shader at point, returns what goes into the color buffer (SDL format, packed with MSAA)
+			const auto shade = [&](const Vector2& point, float weight0, float weight1, float weight2, float interpolatedZ) -> uint32_t
+			{
+				//perspective-correct attributes
+				const float interpolatedW{ 1 / (invW0 * weight0 + invW1 * weight1 + invW2 * weight2) };
+				Varying pixel{ Varying::Interpolate(v0, v1, v2,
+					weight0 * invW0 * interpolatedW, weight1 * invW1 * interpolatedW, weight2 * invW2 * interpolatedW) };
+				pixel.position = Vector4{ point.x, point.y, interpolatedZ, interpolatedW };
+
+				//uv derivatives for mip selection
+				UVDerivatives uvDerivatives{};
+				if constexpr (Varying::Has(VaryingAttribute::uv))
+				{
+					if (needsUVDerivatives)
+						uvDerivatives = uvGradients.GetDerivatives(pixel.uv, interpolatedW);
+				}
+
+				ColorRGB finalColor{ pixelShader.Shade(pixel, uvDerivatives) };
+				finalColor.MaxToOne();
+
+				const uint8_t r{ static_cast<uint8_t>(finalColor.r * 255) };
+				const uint8_t g{ static_cast<uint8_t>(finalColor.g * 255) };
+				const uint8_t b{ static_cast<uint8_t>(finalColor.b * 255) };
+				if constexpr (sampleCount == 1) return SDL_MapRGB(target.pFormat, r, g, b);
+				else return PackSampleColor(r, g, b);
+			};
+
+			const auto writeColor = [&](int pixelIndex, int coverage, uint32_t color)
+			{
+				if constexpr (sampleCount == 1)
+				{
+					target.pColorBuffer[pixelIndex] = color;
+				}
+				else
+				{
+					uint32_t* pSamples{ &target.pSampleColorBuffer[pixelIndex * sampleCount] };
+					for (int sample{}; sample < sampleCount; ++sample)
+					{
+						if (coverage & (1 << sample)) pSamples[sample] = color;
+					}
+				}
+			};
+
+			//coverage (bit per sample) after the depth test, the depth of what passed is written
+			const auto testAndWriteDepth = [&](int px, int py) -> int
+			{
+				const int pixelIndex{ px + py * target.width };
+				if constexpr (sampleCount == 1)
+				{
+					float weight0{}, weight1{}, weight2{};
+					computeWeights(Vector2{ static_cast<float>(px) + 0.5f, static_cast<float>(py) + 0.5f }, weight0, weight1, weight2);
+					if (weight0 < 0 || weight1 < 0 || weight2 < 0) return 0;
+
+					const float interpolatedZ{ 1 / (invZ0 * weight0 + invZ1 * weight1 + invZ2 * weight2) };
+					float& depth{ target.pDepthBuffer[pixelIndex] };
+					if (depthTest == DepthTest::less ? interpolatedZ >= depth : interpolatedZ > depth) return 0;
+					depth = interpolatedZ;
+					return 1;
+				}
+				else
+				{
+					return sampleCoverage.TestAndWriteDepth(px, py, &target.pDepthBuffer[pixelIndex * sampleCount], depthTest);
+				}
+			};
+
+			constexpr bool isDepthOnly{ std::is_same_v<PixelShader, DepthOnlyPixelShader> };
+			if (isDepthOnly || shadingRate.IsFullRate())
+			{
+				for (int px{ minX }; px <= maxX; ++px)
+				{
+					for (int py{ minY }; py <= maxY; ++py)
+					{
+						const Vector2 currentPixel{ static_cast<float>(px) + 0.5f, static_cast<float>(py) + 0.5f };
+						const int pixelIndex{ px + py * target.width };
+
+						float weight0{}, weight1{}, weight2{}, interpolatedZ{};
+						int coverage{ 1 };
+						if constexpr (sampleCount == 1)
+						{
+							//barycentric weights, outside as soon as one is negative
+							weight0 = Vector2::Cross(vec2 - vec1, currentPixel - vec1) * invArea;
+							if (weight0 < 0) continue;
+							weight1 = Vector2::Cross(vec0 - vec2, currentPixel - vec2) * invArea;
+							if (weight1 < 0) continue;
+							weight2 = Vector2::Cross(vec1 - vec0, currentPixel - vec0) * invArea;
+							if (weight2 < 0) continue;
+
+							//depth test
+							interpolatedZ = 1 / (invZ0 * weight0 + invZ1 * weight1 + invZ2 * weight2);
+							float& depth{ target.pDepthBuffer[pixelIndex] };
+							if (depthTest == DepthTest::less ? interpolatedZ >= depth : interpolatedZ > depth) continue;
+							depth = interpolatedZ;
+						}
+						else
+						{
+							//coverage + depth per sample, the shading below runs once for the pixel at its center
+							//(the center may lie just outside the triangle, the weights are extrapolated then)
+							coverage = testAndWriteDepth(px, py);
+							if (coverage == 0) continue;
+
+							computeWeights(currentPixel, weight0, weight1, weight2);
+							interpolatedZ = 1 / (invZ0 * weight0 + invZ1 * weight1 + invZ2 * weight2);
+						}
+						if constexpr (isDepthOnly) continue;
+
+						writeColor(pixelIndex, coverage, shade(currentPixel, weight0, weight1, weight2, interpolatedZ));
+					}
+				}
+				return;
+			}
+
+			//coarse shading: 2x2 pixel quads aligned to the screen, split into blocks of the quad's shading rate
+			//coverage and depth per pixel, one shade per block at its center for every pixel of it that passed
+			for (int quadX{ minX & ~1 }; quadX <= maxX; quadX += 2)
+			{
+				for (int quadY{ minY & ~1 }; quadY <= maxY; quadY += 2)
+				{
+					const ShadingRate rate{ shadingRate.GetRate(quadX, quadY, target.width, target.height) };
+					const int blockWidth{ ShadingRateSettings::GetWidth(rate) };
+					const int blockHeight{ ShadingRateSettings::GetHeight(rate) };
+
+					for (int blockX{ quadX }; blockX < quadX + 2; blockX += blockWidth)
+					{
+						for (int blockY{ quadY }; blockY < quadY + 2; blockY += blockHeight)
+						{
+							int coverages[2][2]{};
+							bool isCovered{ false };
+							for (int x{}; x < blockWidth; ++x)
+							{
+								for (int y{}; y < blockHeight; ++y)
+								{
+									const int px{ blockX + x };
+									const int py{ blockY + y };
+									if (px < minX || px > maxX || py < minY || py > maxY) continue;
+									coverages[x][y] = testAndWriteDepth(px, py);
+									isCovered |= coverages[x][y] != 0;
+								}
+							}
+							if (!isCovered) continue;
+
+							const Vector2 blockCenter{ static_cast<float>(blockX) + 0.5f * blockWidth, static_cast<float>(blockY) + 0.5f * blockHeight };
+							float weight0{}, weight1{}, weight2{};
+							computeWeights(blockCenter, weight0, weight1, weight2);
+							const float interpolatedZ{ 1 / (invZ0 * weight0 + invZ1 * weight1 + invZ2 * weight2) };
+							const uint32_t color{ shade(blockCenter, weight0, weight1, weight2, interpolatedZ) };
+
+							for (int x{}; x < blockWidth; ++x)
+							{
+								for (int y{}; y < blockHeight; ++y)
+								{
+									if (coverages[x][y] != 0) writeColor((blockX + x) + (blockY + y) * target.width, coverages[x][y], color);
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+
+		template<int sampleCount, typename Varying, typename PixelShader>
+		void RasterizeMeshlets(const Mesh& mesh, const uint32_t* pMeshletIndices, size_t meshletCount, const Varying* pVaryings,
+			const PixelShader& pixelShader, bool needsUVDerivatives, DepthTest depthTest, const ShadingRateSettings& shadingRate, const RenderTarget& target)
+		{
+			for (size_t i{}; i < meshletCount; ++i)
+			{
+				const Meshlet& meshlet{ mesh.meshlets[pMeshletIndices[i]] };
+				const Varying* pMeshletVaryings{ pVaryings + meshlet.vertexOffset };
+				const uint8_t* pTriangle{ mesh.meshletTriangles.data() + meshlet.triangleOffset * 3 };
+				for (uint32_t t{}; t < meshlet.triangleCount; ++t, pTriangle += 3)
+				{
+					RasterizeTriangle<sampleCount>(pMeshletVaryings[pTriangle[0]], pMeshletVaryings[pTriangle[1]], pMeshletVaryings[pTriangle[2]],
+						pixelShader, needsUVDerivatives, depthTest, shadingRate, target);
+				}
+			}
+		}
+	}
+
+	template<typename VertexShader, typename PixelShader>
+	void DrawMesh(const Mesh& mesh, const VertexShader& vertexShader, const PixelShader& pixelShader,
+		const RenderTarget& target, FrameArena& frameArena, ThreadPool& threadPool, DepthTest depthTest,
+		const ShadingRateSettings& shadingRate, MeshletCulling* pMeshletCulling)
+	{
+		using Varying = typename VertexShader::Varying;
+
+		//meshlet culling, the visible ones stay in mesh order so neighbours can share a vertex kernel call
+		const size_t meshletCount{ mesh.meshlets.size() };
+		ArenaArray<uint32_t> visibleMeshlets{ frameArena.AllocateArray<uint32_t>(meshletCount) };
+		size_t visibleCount{};
+		for (size_t i{}; i < meshletCount; ++i)
+		{
+			if (pMeshletCulling && pMeshletCulling->IsCulled(mesh.meshlets[i])) continue;
+			visibleMeshlets[visibleCount++] = static_cast<uint32_t>(i);
+		}
+		if (pMeshletCulling)
+		{
+			pMeshletCulling->testedCount += static_cast<uint32_t>(meshletCount);
+			pMeshletCulling->culledCount += static_cast<uint32_t>(meshletCount - visibleCount);
+		}
+		const uint32_t* pVisibleMeshlets{ visibleMeshlets.data() };
+
+		//vertex stage over the visible meshlets only, pre-sized so every worker writes its own disjoint range
+		//meshlets start on a SIMD batch, so every kernel call does too
+		ArenaArray<Varying> varyings{ frameArena.AllocateArray<Varying>(mesh.meshletVerticesSoA.count) };
+		Varying* pVaryings{ varyings.data() };
+
+		//16 meshlets are about 1000 vertices
+		constexpr size_t meshletGrainSize{ 16 };
+		threadPool.ParallelFor(visibleCount, meshletGrainSize, [&](size_t begin, size_t end)
+			{
+				size_t i{ begin };
+				while (i < end)
+				{
+					//a run of meshlets that follow each other in the stream, padding in between included
+					const size_t vertexBegin{ mesh.meshlets[pVisibleMeshlets[i]].vertexOffset };
+					for (++i; i < end && pVisibleMeshlets[i] == pVisibleMeshlets[i - 1] + 1; ++i) {}
+					const Meshlet& last{ mesh.meshlets[pVisibleMeshlets[i - 1]] };
+					vertexShader.ShadeVertices(mesh.meshletVerticesSoA, vertexBegin, last.vertexOffset + last.vertexCount, pVaryings);
+				}
+			});
+
+		//raster stage, one loop per sample count
+		const bool needsUVDerivatives{ pixelShader.NeedsUVDerivatives() };
+		if (target.sampleCount == 4)
+		{
+			PipelineDetail::RasterizeMeshlets<4>(mesh, pVisibleMeshlets, visibleCount, pVaryings, pixelShader, needsUVDerivatives, depthTest, shadingRate, target);
+		}
+		else
+		{
+			PipelineDetail::RasterizeMeshlets<1>(mesh, pVisibleMeshlets, visibleCount, pVaryings, pixelShader, needsUVDerivatives, depthTest, shadingRate, target);
+		}
+	}
+
+	inline void ResolveMultisample(const RenderTarget& target, ThreadPool& threadPool)
+	{
+		constexpr size_t rowGrainSize{ 16 };
+		threadPool.ParallelFor(static_cast<size_t>(target.height), rowGrainSize, [&](size_t begin, size_t end)
+			{
+				for (size_t py{ begin }; py < end; ++py)
+				{
+					const size_t rowStart{ py * target.width };
+					for (size_t px{}; px < static_cast<size_t>(target.width); ++px)
+					{
+						const uint32_t* pSamples{ &target.pSampleColorBuffer[(rowStart + px) * 4] };
+						uint32_t r{}, g{}, b{};
+						for (int sample{}; sample < 4; ++sample)
+						{
+							r += pSamples[sample] & 0xff;
+							g += (pSamples[sample] >> 8) & 0xff;
+							b += (pSamples[sample] >> 16) & 0xff;
+						}
+						target.pColorBuffer[rowStart + px] = SDL_MapRGB(target.pFormat,
+							static_cast<uint8_t>((r + 2) / 4), static_cast<uint8_t>((g + 2) / 4), static_cast<uint8_t>((b + 2) / 4));
+					}
+				}
+			});
+	}
+
+	namespace PipelineDetail
+	{
+		//weight in [0, 256], both bytes of a lane pair at once (0x00ff00ff)
+		inline uint32_t LerpBytePairs(uint32_t a, uint32_t b, uint32_t weight)
+		{
+			return ((a * (256 - weight) + b * weight) >> 8) & 0x00ff00ff;
+		}
+
+		inline uint32_t LerpColor(uint32_t a, uint32_t b, uint32_t weight)
+		{
+			return LerpBytePairs(a & 0x00ff00ff, b & 0x00ff00ff, weight) | LerpBytePairs((a >> 8) & 0x00ff00ff, (b >> 8) & 0x00ff00ff, weight) << 8;
+		}
+	}
+
+	inline void UpscaleBilinear(const RenderTarget& source, const RenderTarget& destination, ThreadPool& threadPool)
+	{
+		//destination pixel centers mapped onto the source, 8 bit fractions
+		const float scaleX{ float(source.width) / float(destination.width) };
+		const float scaleY{ float(source.height) / float(destination.height) };
+
+		constexpr size_t rowGrainSize{ 16 };
+		threadPool.ParallelFor(static_cast<size_t>(destination.height), rowGrainSize, [&](size_t begin, size_t end)
+			{
+				for (size_t py{ begin }; py < end; ++py)
+				{
+					const float sourceY{ std::clamp((float(py) + 0.5f) * scaleY - 0.5f, 0.f, float(source.height - 1)) };
+					const int y0{ static_cast<int>(sourceY) };
+					const int y1{ std::min(y0 + 1, source.height - 1) };
+					const uint32_t weightY{ static_cast<uint32_t>((sourceY - float(y0)) * 256.f) };
+					const uint32_t* pRow0{ &source.pColorBuffer[static_cast<size_t>(y0) * source.width] };
+					const uint32_t* pRow1{ &source.pColorBuffer[static_cast<size_t>(y1) * source.width] };
+					uint32_t* pDestination{ &destination.pColorBuffer[py * destination.width] };
+
+					for (int px{}; px < destination.width; ++px)
+					{
+						const float sourceX{ std::clamp((float(px) + 0.5f) * scaleX - 0.5f, 0.f, float(source.width - 1)) };
+						const int x0{ static_cast<int>(sourceX) };
+						const int x1{ std::min(x0 + 1, source.width - 1) };
+						const uint32_t weightX{ static_cast<uint32_t>((sourceX - float(x0)) * 256.f) };
+
+						const uint32_t top{ PipelineDetail::LerpColor(pRow0[x0], pRow0[x1], weightX) };
+						const uint32_t bottom{ PipelineDetail::LerpColor(pRow1[x0], pRow1[x1], weightX) };
+						pDestination[px] = PipelineDetail::LerpColor(top, bottom, weightY);
+					}
+				}
+			});
+	}
+
+	inline TriangleUVGradients TriangleUVGradients::Compute(const Vector4& position0, const Vector4& position1, const Vector4& position2,
+		const Vector2& uv0, const Vector2& uv1, const Vector2& uv2)
+	{
+		const Vector2 edge1{ position1.x - position0.x, position1.y - position0.y };
+		const Vector2 edge2{ position2.x - position0.x, position2.y - position0.y };
+		const float invArea{ 1.f / Vector2::Cross(edge1, edge2) };
+
+		//gradient of a value that is linear in screen space, from its value at the 3 vertices
+		const auto gradient = [&](float f0, float f1, float f2)
+		{
+			return Vector2
+			{
+				((f1 - f0) * edge2.y - (f2 - f0) * edge1.y) * invArea,
+				((f2 - f0) * edge1.x - (f1 - f0) * edge2.x) * invArea
+			};
+		};
+
+		const float invW0{ 1.f / position0.w };
+		const float invW1{ 1.f / position1.w };
+		const float invW2{ 1.f / position2.w };
+
+		return TriangleUVGradients
+		{
+			gradient(uv0.x * invW0, uv1.x * invW1, uv2.x * invW2),
+			gradient(uv0.y * invW0, uv1.y * invW1, uv2.y * invW2),
+			gradient(invW0, invW1, invW2)
+		};
+	}
+
+	inline UVDerivatives TriangleUVGradients::GetDerivatives(const Vector2& uv, float interpolatedW) const
+	{
+		//quotient rule on uv = (uv/w) / (1/w)
+		return UVDerivatives
+		{
+			Vector2{ (uOverW.x - uv.x * oneOverW.x) * interpolatedW, (vOverW.x - uv.y * oneOverW.x) * interpolatedW },
+			Vector2{ (uOverW.y - uv.x * oneOverW.y) * interpolatedW, (vOverW.y - uv.y * oneOverW.y) * interpolatedW }
+		};
+	}
+}
@@ -7,12 +7,23 @@
 #include "Math.h"
 #include "Matrix.h"
 #include "Texture.h"
+#include "Material.h"
+#include "Pipeline.h"
+#include "ThreadPool.h"
 #include "Utils.h"
+#include "VertexKernel.h"
+#include "VirtualTexture.h"
+
+#include <algorithm>
+
+//Asserts (debug builds only) when a frame after warm-up does a heap allocation
+//#define ASSERT_NO_FRAME_HEAP_ALLOCATIONS
 
 using namespace dae;
 
 Renderer::Renderer(SDL_Window* pWindow) :
-	m_pWindow(pWindow)
+	m_pWindow(pWindow),
+	m_pThreadPool{ std::make_unique<ThreadPool>() }
 {
 
 	//Initialize
@@ -20,6 +31,9 @@ Renderer::Renderer(SDL_Window* pWindow) :
 
 	//init depthBuffer
 	m_pDepthBufferPixels = new float[m_Width * m_Height]();
+	m_SampleDepthBuffer.resize(static_cast<size_t>(m_Width) * m_Height * 4);
+	m_SampleColorBuffer.resize(static_cast<size_t>(m_Width) * m_Height * 4);
+	m_ScaledColorBuffer.resize(static_cast<size_t>(m_Width) * m_Height);
 
 	//Create Buffers
 	m_pFrontBuffer = SDL_GetWindowSurface(pWindow);
@@ -34,16 +48,29 @@ Renderer::Renderer(SDL_Window* pWindow) :
 
 	m_CurrentRenderState = RenderState::combined;
 
-	//loadTexture
-	m_pDiffuseTexture = Texture::LoadFromFile("Resources/vehicle_diffuse.png");
+	//all assets load in parallel on the thread pool, rendering starts right away with placeholders
+	//(mid gray, flat normal, no gloss or specular) and without the mesh
+	m_pDiffuseTexture = AssetLoader::CreatePlaceholder(0xff808080);
+	m_pNormalTexture = AssetLoader::CreatePlaceholder(0xffff8080);
+	m_pGlossTexture = AssetLoader::CreatePlaceholder(0xff000000);
+	m_pSpecularTexture = AssetLoader::CreatePlaceholder(0xff000000);
 
-	m_pNormalTexture = Texture::LoadFromFile("Resources/vehicle_normal.png");
+	m_pAssetLoader = std::make_unique<AssetLoader>(*m_pThreadPool);
 
-	m_pGlossTexture = Texture::LoadFromFile("Resources/vehicle_gloss.png");
+	//the mesh first, nothing shows without it
+	m_MeshLoad = m_pAssetLoader->LoadMesh("Resources/vehicle.obj");
 
-	m_pSpecularTexture = Texture::LoadFromFile("Resources/vehicle_specular.png");
+	//block compressed: BC1 for colors, BC4 for the single channel gloss map, BC5 for the normal map
+	const TextureLoadOptions colorOptions{ TextureLayout::tiled4x4, TextureFormat::bc1 };
+	const TextureLoadOptions normalOptions{ TextureLayout::tiled4x4, TextureFormat::bc5 };
+	const TextureLoadOptions glossOptions{ TextureLayout::tiled4x4, TextureFormat::bc4 };
+	m_DiffuseTextureLoad = m_pAssetLoader->LoadTexture("Resources/vehicle_diffuse.png", colorOptions);
+	m_NormalTextureLoad = m_pAssetLoader->LoadTexture("Resources/vehicle_normal.png", normalOptions);
+	m_GlossTextureLoad = m_pAssetLoader->LoadTexture("Resources/vehicle_gloss.png", glossOptions);
+	m_SpecularTextureLoad = m_pAssetLoader->LoadTexture("Resources/vehicle_specular.png", colorOptions);
+	//the virtual textures are paged from what these write to the texture cache, once they are switched on (F10)
 
-	Utils::ParseOBJ("Resources/vehicle.obj", m_Meshes[0].vertices, m_Meshes[0].indices);
+	m_Lights = CreateSceneLights();
 
 	
 	
@@ -56,8 +83,18 @@ Renderer::~Renderer()
 
 void Renderer::Update(Timer* pTimer)
 {
+	//heap allocations are counted over the whole Update + Render
+	m_AllocationCountAtFrameStart = HeapTracking::GetAllocationCount();
+
+	UpdateAssetLoading();
+
 	m_Camera.Update(pTimer);
 
+	if (m_DynamicResolutionToggle)
+	{
+		m_DynamicResolution.Update(pTimer->GetElapsed());
+	}
+
 	if (m_RotationToggle)
 	{
 		m_Meshes[0].RotateMesh(pTimer);
@@ -67,11 +104,29 @@ void Renderer::Update(Timer* pTimer)
 
 void Renderer::Render()
 {
+	//everything allocated last frame is gone
+	m_FrameArena.Reset();
+
 	//init Depth Buffer with FLT_MAX
 	std::fill_n(m_pDepthBufferPixels, (m_Width * m_Height), FLT_MAX);
 	
 	//clear buffer
-	SDL_FillRect(m_pBackBuffer, NULL, SDL_MapRGB(m_pBackBuffer->format, 100, 100, 100));
+	//with dynamic resolution only the viewport is drawn to, the upscale then writes every back buffer pixel
+	const uint32_t clearColor{ SDL_MapRGB(m_pBackBuffer->format, 100, 100, 100) };
+	if (m_DynamicResolutionToggle)
+	{
+		const RenderTarget target{ GetRenderTarget() };
+		std::fill_n(m_ScaledColorBuffer.begin(), static_cast<size_t>(target.width) * target.height, clearColor);
+	}
+	else
+	{
+		SDL_FillRect(m_pBackBuffer, NULL, clearColor);
+	}
+	if (m_MultisampleToggle)
+	{
+		std::fill(m_SampleDepthBuffer.begin(), m_SampleDepthBuffer.end(), FLT_MAX);
+		std::fill(m_SampleColorBuffer.begin(), m_SampleColorBuffer.end(), PackSampleColor(100, 100, 100));
+	}
 
 	//@START
 	
@@ -98,40 +153,171 @@ void Renderer::Render()
 	SDL_UnlockSurface(m_pBackBuffer);
 	SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
 	SDL_UpdateWindowSurface(m_pWindow);
+
+	UpdateVirtualTextures();
+	UpdateFrameStats();
 }
 
-void Renderer::VertexTransformationFunction(Mesh& mesh) const
+void Renderer::UpdateAssetLoading()
 {
-	//Todo > W1 Projection Stage
-	Matrix worldViewProjectionMatrix;
-	Matrix WorldMatrix{ mesh.worldMatrix };
-	//vertices_out = vertices_in;
-	for (auto& vertexOut : mesh.vertices)
+	if (!IsLoadingAssets()) return;
+
+	//swap in every asset that finished since last frame
+	AssetLoader::TryTake(m_DiffuseTextureLoad, m_pDiffuseTexture);
+	AssetLoader::TryTake(m_NormalTextureLoad, m_pNormalTexture);
+	AssetLoader::TryTake(m_GlossTextureLoad, m_pGlossTexture);
+	AssetLoader::TryTake(m_SpecularTextureLoad, m_pSpecularTexture);
+
+	AssetLoader::MeshData meshData{};
+	if (AssetLoader::TryTake(m_MeshLoad, meshData))
 	{
-		worldViewProjectionMatrix = mesh.worldMatrix * m_Camera.viewProjectionMatrix;
+		m_Meshes[0].vertices = std::move(meshData.vertices);
+		m_Meshes[0].indices = std::move(meshData.indices);
+		m_Meshes[0].BuildVertexStream();
+	}
+
+	//the packed material needs all 4 maps, the maps are only read so rendering can go on
+	const bool areMapsLoaded{ !m_DiffuseTextureLoad.valid() && !m_NormalTextureLoad.valid() && !m_GlossTextureLoad.valid() && !m_SpecularTextureLoad.valid() };
+	if (areMapsLoaded && !m_IsPackedMaterialBuildStarted)
+	{
+		m_IsPackedMaterialBuildStarted = true;
+		//kept for the virtual textures, the maps are released once packed
+		m_DiffuseCacheFile = m_pDiffuseTexture->GetCacheFile();
+		m_NormalCacheFile = m_pNormalTexture->GetCacheFile();
+		m_GlossCacheFile = m_pGlossTexture->GetCacheFile();
+		m_SpecularCacheFile = m_pSpecularTexture->GetCacheFile();
+		m_PackedMaterialBuild = m_pThreadPool->Enqueue(
+			[pDiffuse = m_pDiffuseTexture.get(), pNormal = m_pNormalTexture.get(), pGloss = m_pGlossTexture.get(), pSpecular = m_pSpecularTexture.get()]
+			{
+				//the blocks of the 4 maps interleaved into 2 textures
+				return PackedMaterial::Create(*pDiffuse, *pNormal, *pGloss, *pSpecular);
+			});
+	}
 
-		//Vector4 newVertex{vertexOut.position.x, vertexOut.position.y, vertexOut.position.z, 1 };
-		Vertex_Out newVertexOut
+	if (AssetLoader::TryTake(m_PackedMaterialBuild, m_pPackedMaterial))
+	{
+		//the packed textures hold the same blocks, the separate maps are not sampled anymore
+		if (m_pPackedMaterial)
 		{
-			worldViewProjectionMatrix.TransformPoint({vertexOut.position, 1.f}),
-			vertexOut.color,
-			vertexOut.uv,
-			mesh.worldMatrix.TransformVector(vertexOut.normal).Normalized(),
-			mesh.worldMatrix.TransformVector(vertexOut.tangent).Normalized(),
-			(mesh.worldMatrix.TransformVector(vertexOut.position) - m_Camera.origin).Normalized()
-		};
+			m_pDiffuseTexture.reset();
+			m_pNormalTexture.reset();
+			m_pGlossTexture.reset();
+			m_pSpecularTexture.reset();
+		}
+	}
 
+	//the frames while loading allocate, the steady state starts now
+	if (!IsLoadingAssets()) m_FrameCount = 0;
+}
 
-		//perspective divide
-		newVertexOut.position.x /= newVertexOut.position.w;
-		newVertexOut.position.y /= newVertexOut.position.w;
-		newVertexOut.position.z /= newVertexOut.position.w;
-		newVertexOut.position.w = newVertexOut.position.w;
+bool Renderer::IsLoadingAssets() const
+{
+	//the virtual textures are not part of it, they only load on demand
+	return !m_IsPackedMaterialBuildStarted || m_PackedMaterialBuild.valid() || m_MeshLoad.valid();
+}
 
-		mesh.vertices_out.emplace_back(newVertexOut);
+void Renderer::LoadVirtualTextures()
+{
+	//the pages come from the texture cache files of the maps, so they have to be loaded first
+	if (m_IsVirtualTextureLoadStarted || !m_IsPackedMaterialBuildStarted) return;
+	m_IsVirtualTextureLoadStarted = true;
+
+	//the same 4 maps as virtual textures, at most 256 KB of pages resident per map (+ the mip tail)
+	//the page files are reused across runs, otherwise written once from the mapped cache file (no decode)
+	constexpr size_t virtualTextureBudget{ 256 * 1024 };
+	m_VirtualDiffuseLoad = m_pAssetLoader->LoadVirtualTexture(m_DiffuseCacheFile, virtualTextureBudget);
+	m_VirtualNormalLoad = m_pAssetLoader->LoadVirtualTexture(m_NormalCacheFile, virtualTextureBudget);
+	m_VirtualGlossLoad = m_pAssetLoader->LoadVirtualTexture(m_GlossCacheFile, virtualTextureBudget);
+	m_VirtualSpecularLoad = m_pAssetLoader->LoadVirtualTexture(m_SpecularCacheFile, virtualTextureBudget);
+}
 
+void Renderer::UpdateVirtualTextures()
+{
+	m_FrameStats.virtualPagesResident = 0;
+	m_FrameStats.virtualPageLoads = 0;
+	m_FrameStats.virtualPagesMissing = 0;
+
+	//loaded after the first F10 (or once the maps are in, when F10 came first), the image changes once all 4 are in
+	if (m_VirtualTextureToggle) LoadVirtualTextures();
+	bool hasTakenVirtualTexture{ false };
+	hasTakenVirtualTexture |= AssetLoader::TryTake(m_VirtualDiffuseLoad, m_pVirtualDiffuse);
+	hasTakenVirtualTexture |= AssetLoader::TryTake(m_VirtualNormalLoad, m_pVirtualNormal);
+	hasTakenVirtualTexture |= AssetLoader::TryTake(m_VirtualGlossLoad, m_pVirtualGloss);
+	hasTakenVirtualTexture |= AssetLoader::TryTake(m_VirtualSpecularLoad, m_pVirtualSpecular);
+	if (hasTakenVirtualTexture)
+	{
+		m_TemporalCache.Invalidate();
+		//loading allocated, the steady state starts again
+		m_FrameCount = 0;
 	}
-	
+
+	//pages requested while shading this frame become resident for the next one
+	for (VirtualTexture* pVirtualTexture : { m_pVirtualDiffuse.get(), m_pVirtualNormal.get(), m_pVirtualGloss.get(), m_pVirtualSpecular.get() })
+	{
+		if (!pVirtualTexture) continue;
+
+		pVirtualTexture->Update();
+
+		const VirtualTextureStats& stats{ pVirtualTexture->GetStats() };
+		m_FrameStats.virtualPagesResident += stats.residentPages;
+		m_FrameStats.virtualPageLoads += stats.pageLoads;
+		m_FrameStats.virtualPagesMissing += stats.missingPages;
+	}
+}
+
+void Renderer::UpdateFrameStats()
+{
+	m_FrameStats.arenaUsed = m_FrameArena.GetUsed();
+	m_FrameStats.arenaHighWaterMark = m_FrameArena.GetHighWaterMark();
+	m_FrameStats.heapAllocations = HeapTracking::GetAllocationCount() - m_AllocationCountAtFrameStart;
+
+#ifdef ASSERT_NO_FRAME_HEAP_ALLOCATIONS
+	//the first frames are allowed to allocate (arena growing, lazy init, ...)
+	constexpr uint32_t warmUpFrames{ 5 };
+	assert((m_FrameCount < warmUpFrames || m_FrameStats.heapAllocations == 0) && "Heap allocation in the steady-state frame loop");
+#endif
+
+	++m_FrameCount;
+}
+
+void Renderer::VertexTransformationFunction(Mesh& mesh)
+{
+	//Todo > W1 Projection Stage
+	if (mesh.streamVertexCount != mesh.vertices.size())
+	{
+		mesh.BuildVertexStream();
+	}
+
+	//matrices only change per mesh, not per vertex
+	const Matrix worldViewProjection{ mesh.worldMatrix * m_Camera.viewProjectionMatrix };
+	const Matrix& world{ mesh.worldMatrix };
+
+	//pre-sized so every worker writes its own disjoint range
+	//the SIMD stream is in meshlet order, these paths index mesh.vertices so they transform it one vertex at a time
+	mesh.vertices_out = m_FrameArena.AllocateArray<Vertex_Out>(mesh.vertices.size());
+	Vertex_Out* pVerticesOut{ mesh.vertices_out.data() };
+
+	constexpr size_t vertexGrainSize{ 4096 };
+	m_pThreadPool->ParallelFor(mesh.vertices.size(), vertexGrainSize, [&](size_t begin, size_t end)
+		{
+			for (size_t i{ begin }; i < end; ++i)
+			{
+				const Vertex& vertex{ mesh.vertices[i] };
+				Vertex_Out& vertexOut{ pVerticesOut[i] };
+
+				//perspective divide, w is kept
+				vertexOut.position = worldViewProjection.TransformPoint({ vertex.position, 1.f });
+				vertexOut.position.x /= vertexOut.position.w;
+				vertexOut.position.y /= vertexOut.position.w;
+				vertexOut.position.z /= vertexOut.position.w;
+
+				vertexOut.color = vertex.color;
+				vertexOut.uv = vertex.uv;
+				vertexOut.normal = world.TransformVector(vertex.normal).Normalized();
+				vertexOut.tangent = world.TransformVector(vertex.tangent).Normalized();
+				vertexOut.viewDirection = (world.TransformVector(vertex.position) - m_Camera.origin).Normalized();
+			}
+		});
 }
 
 bool dae::Renderer::IsInTriangle(const std::vector<Vector2>& verticesScreenspace, const Vector2& pixelPos)
@@ -742,10 +928,7 @@ void dae::Renderer::render_W3_Part1()
 		const Vector2 v2{Meshes[0].vertices_out[indc2].position.x, Meshes[0].vertices_out[indc2].position.y };
 
 		//vertices 2D
-		std::vector<Vector2> vertices{};
-		vertices.push_back(v0);
-		vertices.push_back(v1);
-		vertices.push_back(v2);
+		const Vector2 vertices[3]{ v0, v1, v2 };
 
 		Vector2 topLeft{};
 		Vector2 bottomRight{};
@@ -849,9 +1032,6 @@ void dae::Renderer::render_W3_Part1()
 
 void dae::Renderer::render_W3_Part2()
 {
-	//clear global mesh variable
-	m_Meshes[0].vertices_out.clear();
-
 	//transform vector to display on your screen
 	VertexTransformationFunction(m_Meshes[0]);
 
@@ -889,11 +1069,7 @@ void dae::Renderer::render_W3_Part2()
 		const Vector2 vec2{v2.position.x, v2.position.y}; 
 
 		//vertices 2D
-		std::vector<Vector2> vertices{};
-		vertices.resize(3);
-		vertices[0] = vec0;
-		vertices[1] = vec1;
-		vertices[2] = vec2;
+		const Vector2 vertices[3]{ vec0, vec1, vec2 };
 		
 		Vector2 topLeft{};
 		Vector2 bottomRight{};
@@ -987,216 +1163,225 @@ void dae::Renderer::render_W3_Part2()
 
 void Renderer::render_W4_Part1()
 {
-	//clear global mesh variable
-	m_Meshes[0].vertices_out.clear();
-
-	VertexTransformationFunction(m_Meshes[0]);
+	//the shader variant is picked once per frame, every variant has its own raster loop with the shader inlined
+	using RasterVariant = void (Renderer::*)();
+	//[render state][no normal map, normal map in world space, normal map in tangent space]
+	static constexpr RasterVariant rasterVariants[4][3]
+	{
+		{ &Renderer::RasterizeShaded<RenderState::observedArea, false, false>, &Renderer::RasterizeShaded<RenderState::observedArea, true, false>, &Renderer::RasterizeShaded<RenderState::observedArea, true, true> },
+		{ &Renderer::RasterizeShaded<RenderState::lambert, false, false>, &Renderer::RasterizeShaded<RenderState::lambert, true, false>, &Renderer::RasterizeShaded<RenderState::lambert, true, true> },
+		{ &Renderer::RasterizeShaded<RenderState::phong, false, false>, &Renderer::RasterizeShaded<RenderState::phong, true, false>, &Renderer::RasterizeShaded<RenderState::phong, true, true> },
+		{ &Renderer::RasterizeShaded<RenderState::combined, false, false>, &Renderer::RasterizeShaded<RenderState::combined, true, false>, &Renderer::RasterizeShaded<RenderState::combined, true, true> }
+	};
 
-	int adder{};
-	if (m_Meshes[0].primitiveTopology == PrimitiveTopology::TriangleList)
+	//only re-rendered when the light or a mesh moved
+	if (m_ShadowFilter != ShadowFilter::off)
 	{
-		adder = 3;
+		m_ShadowMap.Update(m_Meshes, m_LightDirection, m_FrameArena, *m_pThreadPool);
 	}
-	else
+	m_FrameStats.shadowMapRenders = m_ShadowMap.GetRenderCount();
+
+	const int normalVariant{ !m_NormalMapToggle ? 0 : (m_TangentSpaceLightingToggle ? 2 : 1) };
+	(this->*rasterVariants[static_cast<int>(m_CurrentRenderState)][normalVariant])();
+
+	const RenderTarget target{ GetRenderTarget() };
+	if (m_MultisampleToggle)
 	{
-		adder = 1;
+		ResolveMultisample(target, *m_pThreadPool);
 	}
-
-	//int count{};
-	for (int i{}; i < m_Meshes[0].vertices_out.size(); i += adder)
+	if (m_DynamicResolutionToggle)
 	{
+		UpscaleBilinear(target, RenderTarget{ m_pBackBufferPixels, nullptr, m_Width, m_Height, m_pBackBuffer->format }, *m_pThreadPool);
+	}
+	m_FrameStats.renderWidth = target.width;
+	m_FrameStats.renderHeight = target.height;
+}
 
-		uint32_t indc0{ m_Meshes[0].indices[i] };
-		uint32_t indc1{ m_Meshes[0].indices[i + 1] };
-		uint32_t indc2{ m_Meshes[0].indices[i + 2] };
+template<Renderer::RenderState renderState, bool useNormalMap, bool tangentSpaceLighting>
+void Renderer::RasterizeShaded()
+{
+	using PixelShader = VehiclePixelShader<renderState, useNormalMap, tangentSpaceLighting>;
+	const RenderTarget target{ GetRenderTarget() };
 
-		if (m_Meshes[0].primitiveTopology == PrimitiveTopology::TriangleStrip && (i & 2) != 0)
+	//meshes front to back by their nearest point, so the ones drawn first can occlude the ones after them
+	struct MeshDraw
+	{
+		size_t meshIndex;
+		OcclusionCuller::ScreenBounds bounds;
+		bool isOccluded;
+	};
+	for (Mesh& mesh : m_Meshes)
+	{
+		if (mesh.streamVertexCount != mesh.vertices.size())
 		{
-			std::swap(indc1, indc2);
+			mesh.BuildVertexStream();
 		}
+	}
 
-		//cach vertices
-		//vertex_out
-		Vertex_Out v0{ m_Meshes[0].vertices_out[indc0]};
-		Vertex_Out v1{ m_Meshes[0].vertices_out[indc1]};
-		Vertex_Out v2{ m_Meshes[0].vertices_out[indc2]};
-
-		//fustrum culling
-		if (FustrumCulling(v0.position, v1.position, v2.position)) continue;
-
-		//screenSpace
-		ToScreenSpace(v0.position, v1.position, v2.position);
-		
-		//Vector2 for cross
-		const Vector2 vec0{ v0.position.x, v0.position.y };
-		const Vector2 vec1{ v1.position.x, v1.position.y };
-		const Vector2 vec2{ v2.position.x, v2.position.y };
-
-		//vertices 2D
-		std::vector<Vector2> vertices{};
-		vertices.resize(3);
-		vertices[0] = vec0;
-		vertices[1] = vec1;
-		vertices[2] = vec2;
-
-		//boundingBox Optimization
-		Vector2 topLeft{};
-		Vector2 bottomRight{};
-
-		BoundingBox(topLeft, bottomRight, vertices);
+	//meshes outside the view frustum never reach the vertex stage
+	m_MeshBVH.Build(m_Meshes);
+	const Frustum frustum{ Frustum::FromViewProjection(m_Camera.viewProjectionMatrix) };
 
-		//RENDER LOGIC
-		for (int px{ static_cast<int>(topLeft.x) }; px <= static_cast<int>(bottomRight.x); ++px)
+	m_OcclusionCuller.Reset(target.width, target.height);
+	ArenaArray<MeshDraw> draws{ m_FrameArena.AllocateArray<MeshDraw>(m_Meshes.size()) };
+	size_t drawCount{};
+	m_MeshBVH.ForEachVisible(frustum, [&](size_t meshIndex)
 		{
-			for (int py{ static_cast<int>(topLeft.y) }; py <= static_cast<int>(bottomRight.y); ++py)
-			{
-				ColorRGB finalColor{};
-				Vector2 currentPixel = { static_cast<float>(px) + 0.5f, static_cast<float>(py) + 0.5f };
-
-				float weight0 = 0, weight1 = 0, weight2 = 0;
-				float triangleSide0 = 0, triangleSide1 = 0, triangleSide2 = 0;
-
-				float area{ Vector2::Cross((vec1 - vec0), (vec2 - vec0)) };
-
-				//calculate weights
-				weight0 = triangleSide0 = Vector2::Cross(vec2 - vec1, (currentPixel - vec1)) / area;
-				weight1 = triangleSide1 = Vector2::Cross(vec0 - vec2, (currentPixel - vec2)) / area;
-				weight2 = triangleSide2 = Vector2::Cross(vec1 - vec0, (currentPixel - vec0)) / area;
-
-				float totalTriangleWeight{ weight0 + weight1 + weight2 };
-				float invTotalTriangleWeight{ 1 / totalTriangleWeight };
-
-
-				weight0 *= invTotalTriangleWeight;
-				weight1 *= invTotalTriangleWeight;
-				weight2 *= invTotalTriangleWeight;
-
-				//isInTriangleCheck
-				if (triangleSide0 < 0) continue;
-				if (triangleSide1 < 0) continue;
-				if (triangleSide2 < 0) continue;
-
-
-
-				//depth
-				//interpolatedZ
-				const float interpolatedZ =
-					1 / ((1 / v0.position.z) * weight0 +
-						(1 / v1.position.z) * weight1 +
-						(1 / v2.position.z) * weight2);
-
-
-				if (interpolatedZ < m_pDepthBufferPixels[(py * m_Width) + px])
-				{ 
-					//interpolatedW
-					const float interpolatedW =
-						1 / ((1 / v0.position.w) * weight0 +
-							(1 / v1.position.w) * weight1 +
-							(1 / v2.position.w) * weight2);
-
-
-
-					//Position
-					const Vector4 pos = { ((v0.position * weight0) + (v1.position * weight1) + (v2.position * weight2)) * interpolatedW };
-
-
-					//uv
-					const Vector2 interpolatedUv =
-						((v0.uv / v0.position.w) * weight0
-							+ (v1.uv / v1.position.w) * weight1
-							+ (v2.uv / v2.position.w) * weight2) * interpolatedW;
-
-					//normal
-					const Vector3 normal{ ((v0.normal / (v0.position.w)) * weight0
-						+ (v1.normal / v1.position.w) * weight1
-						+ (v2.normal / v2.position.w) * weight2) * interpolatedW };
-
-					//tangent
-					const Vector3 tangent = { ((v0.tangent / v0.position.w) * weight0
-							+ (v1.tangent / v1.position.w) * weight1
-							+ (v2.tangent / v2.position.w) * weight2) * interpolatedW };
-
-					// viewDirection
-						const Vector3 viewDirection = { (((v0.viewDirection / v0.position.w) * weight0
-								+ (v1.viewDirection / v1.position.w) * weight1
-								+ (v2.viewDirection / v2.position.w) * weight2) * interpolatedW)};
-
-
-
+			const Mesh& mesh{ m_Meshes[meshIndex] };
+			const Matrix worldViewProjection{ mesh.worldMatrix * m_Camera.viewProjectionMatrix };
+			const OcclusionCuller::ScreenBounds bounds{ m_OcclusionCuller.ProjectBox(mesh.bounds, worldViewProjection) };
+			//the frustum test is conservative, a box can still miss the screen
+			if (bounds.IsOffScreen()) return;
+			draws[drawCount++] = MeshDraw{ meshIndex, bounds, false };
+		});
+	std::sort(draws.begin(), draws.begin() + drawCount, [](const MeshDraw& a, const MeshDraw& b) { return a.bounds.nearestDepth < b.bounds.nearestDepth; });
+
+	//a hidden mesh skips the vertex stage and the rasterizer, a drawn one refreshes the coarse depth under it
+	const auto testOcclusion = [&](MeshDraw& draw)
+	{
+		draw.isOccluded = m_OcclusionCullingToggle && m_OcclusionCuller.IsOccluded(draw.bounds);
+		return draw.isOccluded;
+	};
+	const auto updateOcclusion = [&](const MeshDraw& draw)
+	{
+		if (m_OcclusionCullingToggle) m_OcclusionCuller.Update(draw.bounds, target.pDepthBuffer, target.sampleCount, *m_pThreadPool);
+	};
 
-					//ColorRGB sampledColor = m_pDiffuseTexture->Sample(interpolatedUv);
-					//sample pixel color
-					switch (m_ColorOutput)
-					{
-					case 0:
-						//finalColor = { sampledColor };
-						break;
-					case 1:
-						float remapedValue{ Remap(interpolatedZ, 0.985f, 1.f)};
-						//std::cout << interpolatedZ << "\n";
-						finalColor = { remapedValue, remapedValue, remapedValue };
-						break;
-					}
-				
+	//matrices only change per mesh, not per vertex
+	const auto getVertexConstants = [this](const Mesh& mesh)
+	{
+		return VertexKernelConstants{ mesh.worldMatrix * m_Camera.viewProjectionMatrix, mesh.worldMatrix, m_Camera.origin, m_LightDirection };
+	};
+	const auto getMeshletCulling = [this](const Mesh& mesh)
+	{
+		return MeshletCulling::Create(mesh.worldMatrix, m_Camera.viewProjectionMatrix, m_Camera.origin, mesh.isClosed, mesh.bounds);
+	};
 
-					m_pDepthBufferPixels[(py * m_Width) + px] = interpolatedZ;
+	//local lights: depth pre-pass for the tile depth ranges, then every pixel of a tile only loops over the lights of that tile
+	//the shading pass afterwards only shades the visible pixels
+	const bool hasLocalLights{ PixelShader::supportsLocalLights && m_LocalLightsToggle && !m_Lights.empty() };
+	if (hasLocalLights)
+	{
+		for (size_t i{}; i < drawCount; ++i)
+		{
+			if (testOcclusion(draws[i])) continue;
+
+			const Mesh& mesh{ m_Meshes[draws[i].meshIndex] };
+			const VehicleVertexShader<0> depthVertexShader{ getVertexConstants(mesh) };
+			//the shading pass culls the same meshlets
+			MeshletCulling meshletCulling{ getMeshletCulling(mesh) };
+			DrawMeshDepth(mesh, depthVertexShader, target, m_FrameArena, *m_pThreadPool, m_MeshletCullingToggle ? &meshletCulling : nullptr);
+			updateOcclusion(draws[i]);
+		}
+		m_LightCulling.Build(m_Lights, m_Camera, target.pDepthBuffer, target.sampleCount, target.width, target.height, *m_pThreadPool);
+	}
+	m_FrameStats.lightTileAssignments = hasLocalLights ? m_LightCulling.GetAssignmentCount() : 0;
+	m_FrameStats.lightTileCount = hasLocalLights ? static_cast<uint32_t>(m_LightCulling.GetTileCount()) : 0;
+	m_FrameStats.lightsDroppedFromTiles = hasLocalLights ? m_LightCulling.GetDroppedCount() : 0;
 
-					//pixel shading
-					Vertex_Out finalPixel{ pos, finalColor, interpolatedUv, normal, tangent, viewDirection };
-					finalColor = PixelShading(finalPixel);
+	const bool hasShadows{ PixelShader::supportsShadows && m_ShadowFilter != ShadowFilter::off && m_ShadowMap.IsValid() };
 
-					//Update Color in Buffer
-					finalColor.MaxToOne();
+	ShadingRateSettings shadingRate{};
+	if (m_ShadingRateMode == ShadingRateMode::perMaterial)
+	{
+		shadingRate.center = shadingRate.periphery = PixelShader::materialShadingRate;
+	}
+	else if (m_ShadingRateMode == ShadingRateMode::periphery)
+	{
+		shadingRate.periphery = ShadingRate::rate2x2;
+		shadingRate.peripheryStart = 0.6f;
+	}
 
-					m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-						static_cast<uint8_t>(finalColor.r * 255),
-						static_cast<uint8_t>(finalColor.g * 255),
-						static_cast<uint8_t>(finalColor.b * 255));
-				}
+	const PixelShader pixelShader{ *this, hasLocalLights, hasShadows };
+	const DepthTest depthTest{ hasLocalLights ? DepthTest::lessEqual : DepthTest::less };
 
+	//temporal cache: the vertex shader also outputs where the vertex was last frame, the pixel shader reuses what was shaded there
+	//needs one pixel shader call per pixel, and the textures to be final
+	const bool hasTemporalCache{ m_TemporalCacheToggle && target.sampleCount == 1 && shadingRate.IsFullRate() && !IsLoadingAssets()
+		&& m_PreviousWorldMatrices.size() == m_Meshes.size() };
+	if (hasTemporalCache)
+	{
+		m_TemporalCache.BeginFrame(target.width, target.height);
+	}
+	else
+	{
+		m_TemporalCache.Invalidate();
+	}
 
-			}
+	uint32_t occludedCount{};
+	uint32_t meshletsTested{};
+	uint32_t meshletsCulled{};
+	for (size_t i{}; i < drawCount; ++i)
+	{
+		//with the pre-pass the occlusion is already known
+		if (hasLocalLights ? draws[i].isOccluded : testOcclusion(draws[i]))
+		{
+			++occludedCount;
+			continue;
 		}
-	}
 
-}
+		const size_t meshIndex{ draws[i].meshIndex };
+		const Mesh& mesh{ m_Meshes[meshIndex] };
+		//the vertex shader only writes the attributes the pixel shader reads
+		const VehicleVertexShader<PixelShader::varyingAttributes> vertexShader{ getVertexConstants(mesh) };
+		MeshletCulling meshletCulling{ getMeshletCulling(mesh) };
+		MeshletCulling* pMeshletCulling{ m_MeshletCullingToggle ? &meshletCulling : nullptr };
+		if (hasTemporalCache)
+		{
+			VehicleVertexShader<PixelShader::varyingAttributes | VaryingAttribute::previousPosition> temporalVertexShader{ vertexShader.constants };
+			temporalVertexShader.constants.previousWorldViewProjection = m_PreviousWorldMatrices[meshIndex] * m_PreviousViewProjection;
+			const TemporalPixelShader<PixelShader> temporalPixelShader{ pixelShader, m_TemporalCache, static_cast<uint16_t>(meshIndex + 1) };
+			DrawMesh(mesh, temporalVertexShader, temporalPixelShader, target, m_FrameArena, *m_pThreadPool, depthTest, shadingRate, pMeshletCulling);
+		}
+		else
+		{
+			DrawMesh(mesh, vertexShader, pixelShader, target, m_FrameArena, *m_pThreadPool, depthTest, shadingRate, pMeshletCulling);
+		}
+		meshletsTested += meshletCulling.testedCount;
+		meshletsCulled += meshletCulling.culledCount;
 
-float Renderer::Remap(float value, float minValue, float maxValue) 
-{
-	//map to range[0,1]
-	return (value - minValue) / (maxValue - minValue);
+		if (!hasLocalLights) updateOcclusion(draws[i]);
+	}
+	m_FrameStats.meshesDrawn = static_cast<uint32_t>(drawCount) - occludedCount;
+	m_FrameStats.meshesOccluded = occludedCount;
+	m_FrameStats.meshesFrustumCulled = m_MeshBVH.GetMeshCount() - static_cast<uint32_t>(drawCount);
+	m_FrameStats.meshletsDrawn = meshletsTested - meshletsCulled;
+	m_FrameStats.meshletsCulled = meshletsCulled;
+	m_FrameStats.temporalReusedPixels = hasTemporalCache ? m_TemporalCache.GetReusedCount() : 0;
+	m_FrameStats.temporalShadedPixels = hasTemporalCache ? m_TemporalCache.GetShadedCount() : 0;
+
+	//only reallocates when the mesh count changes
+	m_PreviousWorldMatrices.resize(m_Meshes.size());
+	for (size_t i{}; i < m_Meshes.size(); ++i)
+	{
+		m_PreviousWorldMatrices[i] = m_Meshes[i].worldMatrix;
+	}
+	m_PreviousViewProjection = m_Camera.viewProjectionMatrix;
 }
 
-bool Renderer::FustrumCulling(const Vector3 v0, const Vector3 v1, const Vector3 v2)
+RenderTarget Renderer::GetRenderTarget()
 {
-	if ((v0.x < -1 || v0.x > 1) ||
-		(v0.y < -1 || v0.y > 1) ||
-		(v0.z < 0 || v0.z > 1) ||
-		(v1.x < -1 || v1.x > 1) ||
-		(v1.y < -1 || v1.y > 1) ||
-		(v1.z < 0 || v1.z > 1) ||
-		(v2.x < -1 || v2.x > 1) ||
-		(v2.y < -1 || v2.y > 1) ||
-		(v2.z < 0 || v2.z > 1))
+	RenderTarget target{ m_pBackBufferPixels, m_pDepthBufferPixels, m_Width, m_Height, m_pBackBuffer->format };
+	if (m_DynamicResolutionToggle)
+	{
+		//viewport in the front of the window-sized buffers, rows are packed at the viewport width
+		target.pColorBuffer = m_ScaledColorBuffer.data();
+		target.width = m_DynamicResolution.GetWidth(m_Width);
+		target.height = m_DynamicResolution.GetHeight(m_Height);
+	}
+	if (m_MultisampleToggle)
 	{
-		return true;
+		target.pDepthBuffer = m_SampleDepthBuffer.data();
+		target.sampleCount = 4;
+		target.pSampleColorBuffer = m_SampleColorBuffer.data();
 	}
-	return false;
+	return target;
 }
 
-void Renderer::ToScreenSpace(Vector4& v0, Vector4& v1, Vector4& v2)
+float Renderer::Remap(float value, float minValue, float maxValue) 
 {
-	//v0
-	v0.x = (v0.x + 1) / 2 * float(m_Width);
-	v0.y = (1 - v0.y) / 2 * float(m_Height);
-
-	//v1
-	v1.x = (v1.x + 1) / 2 * float(m_Width);
-	v1.y = (1 - v1.y) / 2 * float(m_Height);
-
-	//v2
-	v2.x = (v2.x + 1) / 2 * float(m_Width);
-	v2.y = (1- v2.y) / 2 * float(m_Height);
+	//map to range[0,1]
+	return (value - minValue) / (maxValue - minValue);
 }
 
 bool Renderer::SaveBufferToImage() const
@@ -1204,7 +1389,7 @@ bool Renderer::SaveBufferToImage() const
 	return SDL_SaveBMP(m_pBackBuffer, "Rasterizer_ColorBuffer.bmp");
 }
 
-void Renderer::BoundingBox(Vector2& topLeft, Vector2& bottomRight, std::vector<Vector2> v)
+void Renderer::BoundingBox(Vector2& topLeft, Vector2& bottomRight, const Vector2 (&v)[3])
 {
 	//bounding box optimization
 
@@ -1234,68 +1419,190 @@ void Renderer::BoundingBox(Vector2& topLeft, Vector2& bottomRight, std::vector<V
 
 
 
-ColorRGB Renderer::PixelShading(const Vertex_Out& v)
+template<uint32_t channels>
+MaterialSample Renderer::SampleMaterial(const Vector2& uv, const UVDerivatives& uvDerivatives) const
+{
+	//4 fetches from the virtual textures, 2 from the packed textures or 4 from the separate maps until it is built, minus the unused channels
+	MaterialSample material{};
+	if (m_VirtualTextureToggle && m_pVirtualDiffuse && m_pVirtualNormal && m_pVirtualGloss && m_pVirtualSpecular)
+	{
+		if constexpr ((channels & MaterialChannel::diffuse) != 0) material.diffuse = m_pVirtualDiffuse->Sample(uv, m_TextureFilter, uvDerivatives);
+		if constexpr ((channels & MaterialChannel::normal) != 0) material.tangentNormal = 2.f * m_pVirtualNormal->SampleNormal(uv, m_TextureFilter, uvDerivatives) - Vector3(1.f, 1.f, 1.f);
+		if constexpr ((channels & MaterialChannel::gloss) != 0) material.gloss = m_pVirtualGloss->Sample(uv, m_TextureFilter, uvDerivatives).r;
+		if constexpr ((channels & MaterialChannel::specular) != 0) material.specular = m_pVirtualSpecular->Sample(uv, m_TextureFilter, uvDerivatives);
+	}
+	else if (m_pPackedMaterial)
+	{
+		material = m_pPackedMaterial->Sample<channels>(uv, m_TextureFilter, uvDerivatives);
+	}
+	else
+	{
+		if constexpr ((channels & MaterialChannel::diffuse) != 0) material.diffuse = m_pDiffuseTexture->Sample(uv, m_TextureFilter, uvDerivatives);
+		if constexpr ((channels & MaterialChannel::normal) != 0) material.tangentNormal = 2.f * m_pNormalTexture->SampleNormal(uv, m_TextureFilter, uvDerivatives) - Vector3(1.f, 1.f, 1.f);
+		if constexpr ((channels & MaterialChannel::gloss) != 0) material.gloss = m_pGlossTexture->Sample(uv, m_TextureFilter, uvDerivatives).r;
+		if constexpr ((channels & MaterialChannel::specular) != 0) material.specular = m_pSpecularTexture->Sample(uv, m_TextureFilter, uvDerivatives);
+	}
+	return material;
+}
+
+template<Renderer::RenderState renderState, bool useNormalMap, bool tangentSpaceLighting, typename Varying>
+ColorRGB Renderer::PixelShading(const Varying& v, const UVDerivatives& uvDerivatives, bool hasLocalLights, bool hasShadows) const
 {
-	Vector3 lightDirection = { .577f, -.577f, .577f };
 	const float lightIntensity{ 7.f };
 	ColorRGB ambient{ 0.025f, 0.025f , 0.025f };
 	//diffuse reflectivity
 	const float kd{1.f};
 
-	Vector3 sampledNormal{v.normal};
-	
-	Vector3 binormal = Vector3::Cross(v.normal, v.tangent);
-	Matrix tangentSpaceAxis = Matrix{ v.tangent, binormal.Normalized(), v.normal, Vector3::Zero};
-	sampledNormal = m_pNormalTexture->SampleNormal(v.uv);
-	sampledNormal = 2.f * sampledNormal - Vector3(1.f, 1.f, 1.f);
-	sampledNormal = tangentSpaceAxis.TransformVector(sampledNormal);
-	sampledNormal.Normalize();
-	
-	
-
-	//observedArea
-	float observedArea{};
-	if (m_NormalMapToggle) observedArea = Vector3::Dot(sampledNormal, -lightDirection);
+	//only the channels this variant outputs are sampled, the varying only carries uv when one is
+	constexpr uint32_t channels{ GetShaderChannels<renderState, useNormalMap>() };
+	MaterialSample material{};
+	if constexpr (channels != 0)
+	{
+		material = SampleMaterial<channels>(v.uv, uvDerivatives);
+	}
 
-	else observedArea = Vector3::Dot(v.normal, -lightDirection);
+	//lighting happens in world space, or in tangent space where the normal map value is used as is
+	constexpr bool isTangentSpace{ useNormalMap && tangentSpaceLighting };
+	Vector3 lightDirection{};
+	Vector3 sampledNormal{};
+	if constexpr (isTangentSpace)
+	{
+		//the interpolated light direction is shorter than 1 wherever the vertex frames differ
+		lightDirection = v.tangentLightDirection.Normalized();
+		sampledNormal = material.tangentNormal.Normalized();
+	}
+	else if constexpr (useNormalMap)
+	{
+		lightDirection = m_LightDirection;
+		Vector3 binormal = Vector3::Cross(v.normal, v.tangent);
+		Matrix tangentSpaceAxis = Matrix{ v.tangent, binormal.Normalized(), v.normal, Vector3::Zero };
+		sampledNormal = tangentSpaceAxis.TransformVector(material.tangentNormal);
+		sampledNormal.Normalize();
+	}
+	else
+	{
+		lightDirection = m_LightDirection;
+		sampledNormal = v.normal;
+	}
 
+	//observedArea
+	float observedArea{ Vector3::Dot(sampledNormal, -lightDirection) };
 	if (observedArea < 0) observedArea = 0;
 
 	//Diffuse
-	const ColorRGB lambertDiffuse{ (kd * m_pDiffuseTexture->Sample(v.uv)) / float(M_PI) };
+	ColorRGB lambertDiffuse{};
+	if constexpr ((channels & MaterialChannel::diffuse) != 0)
+	{
+		lambertDiffuse = (kd * material.diffuse) / float(M_PI);
+	}
 
-	//phong 
-	const float shininess{ 25.f };
-	const ColorRGB specularColor{ m_pSpecularTexture->Sample(v.uv) };
-	const float phongExp{ m_pGlossTexture->SampleNormal(v.uv).x * shininess };
+	//main light only, the ambient and the local lights are not shadowed
+	float shadow{ 1.f };
+	if constexpr (VehiclePixelShader<renderState, useNormalMap, tangentSpaceLighting>::supportsShadows)
+	{
+		if (hasShadows) shadow = m_ShadowMap.SampleVisibility(v.worldPosition, m_ShadowFilter);
+	}
 
-	const Vector3 reflect{ Vector3::Reflect(-lightDirection, sampledNormal) };
-	float cosAngle{ Vector3::Dot(reflect, v.viewDirection) };
-	if (cosAngle < 0.f) cosAngle = 0.f;
+	//else chain: the discarded branches may read attributes this varying does not have
+	if constexpr (renderState == RenderState::observedArea)
+	{
+		return ColorRGB(observedArea, observedArea, observedArea);
+	}
+	else if constexpr (renderState == RenderState::lambert)
+	{
+		ColorRGB color{ lightIntensity * lambertDiffuse * observedArea * shadow };
+		if constexpr (VehiclePixelShader<renderState, useNormalMap, tangentSpaceLighting>::supportsLocalLights)
+		{
+			if (hasLocalLights) color += ShadeLocalLights<false>(v, sampledNormal, lambertDiffuse, material);
+		}
+		return color;
+	}
+	else
+	{
+		//phong 
+		const ColorRGB specularColor{ material.specular };
 
-	const float specReflection{ kd * powf(cosAngle, phongExp) };
-	const ColorRGB phong{ specReflection * specularColor };
+		Vector3 viewDirection{};
+		if constexpr (isTangentSpace) viewDirection = v.tangentViewDirection;
+		else viewDirection = v.viewDirection;
+
+		const Vector3 reflect{ Vector3::Reflect(-lightDirection, sampledNormal) };
+		float cosAngle{ Vector3::Dot(reflect, viewDirection) };
+		if (cosAngle < 0.f) cosAngle = 0.f;
+
+		const float specReflection{ kd * m_SpecularPower.Evaluate(m_SpecularPowerMode, cosAngle, material.gloss) };
+		const ColorRGB phong{ shadow * specReflection * specularColor };
+
+		ColorRGB color{};
+		if constexpr (renderState == RenderState::phong)
+		{
+			color = phong * observedArea;
+		}
+		else
+		{
+			color = ColorRGB(lightIntensity * lambertDiffuse * observedArea * shadow + ambient + phong);
+		}
+
+		if constexpr (VehiclePixelShader<renderState, useNormalMap, tangentSpaceLighting>::supportsLocalLights)
+		{
+			if (hasLocalLights) color += ShadeLocalLights<true>(v, sampledNormal, lambertDiffuse, material);
+		}
+		return color;
+	}
+}
 
+template<bool withSpecular, typename Varying>
+ColorRGB Renderer::ShadeLocalLights(const Varying& v, const Vector3& normal, const ColorRGB& lambertDiffuse, const MaterialSample& material) const
+{
+	//only the lights the culling put in this pixel's tile
+	const TiledLightCulling::TileLights tileLights{ m_LightCulling.GetTileLights(static_cast<int>(v.position.x), static_cast<int>(v.position.y)) };
 
-	switch (m_CurrentRenderState)
+	ColorRGB color{};
+	for (uint32_t i{}; i < tileLights.count; ++i)
 	{
-	case dae::Renderer::RenderState::observedArea:
-		
-		return ColorRGB(observedArea, observedArea, observedArea);
+		const LightSample light{ EvaluateLight(m_Lights[tileLights.pIndices[i]], v.worldPosition) };
 
-	case dae::Renderer::RenderState::lambert:
+		const float observedArea{ Vector3::Dot(normal, -light.direction) };
+		if (observedArea <= 0.f) continue;
 
-		return lightIntensity * lambertDiffuse * observedArea;
+		ColorRGB brdf{ lambertDiffuse };
+		if constexpr (withSpecular)
+		{
+			const Vector3 reflect{ Vector3::Reflect(-light.direction, normal) };
+			float cosAngle{ Vector3::Dot(reflect, v.viewDirection) };
+			if (cosAngle < 0.f) cosAngle = 0.f;
+			brdf += m_SpecularPower.Evaluate(m_SpecularPowerMode, cosAngle, material.gloss) * material.specular;
+		}
 
-	case dae::Renderer::RenderState::phong:
+		color += light.radiance * brdf * observedArea;
+	}
+	return color;
+}
 
-		return phong * observedArea;
+std::vector<Light> Renderer::CreateSceneLights()
+{
+	//around the vehicle (at z 50): a ring of colored point lights close to the ground and spots shining down from above
+	std::vector<Light> lights{};
+	const Vector3 center{ 0.f, 0.f, 50.f };
 
-	case dae::Renderer::RenderState::combined:
+	constexpr int pointLightCount{ 24 };
+	const ColorRGB pointColors[]{ { 1.f, .3f, .2f }, { .2f, .6f, 1.f }, { .3f, 1.f, .4f }, { 1.f, .8f, .3f } };
+	for (int i{}; i < pointLightCount; ++i)
+	{
+		const float angle{ 2.f * float(M_PI) * i / pointLightCount };
+		const Vector3 position{ center + Vector3{ cosf(angle) * 22.f, -2.f, sinf(angle) * 22.f } };
+		lights.push_back(Light::CreatePoint(position, pointColors[i % 4], 40.f, 12.f));
+	}
 
-		return ColorRGB(lightIntensity * lambertDiffuse * observedArea + ambient + phong);
+	constexpr int spotLightCount{ 8 };
+	for (int i{}; i < spotLightCount; ++i)
+	{
+		const float angle{ 2.f * float(M_PI) * (i + .5f) / spotLightCount };
+		const Vector3 position{ center + Vector3{ cosf(angle) * 10.f, 15.f, sinf(angle) * 10.f } };
+		lights.push_back(Light::CreateSpot(position, -Vector3::UnitY, colors::White, 150.f, 25.f, 20.f, 35.f));
 	}
-	return ColorRGB();
+
+	return lights;
 }
 
 //with int
@@ -1308,6 +1615,7 @@ void Renderer::ToggleColorOutput()
 void Renderer::ToggleRenderOutput()
 {
 	m_CurrentRenderState = RenderState((int(m_CurrentRenderState) + 1) % 4);
+	m_TemporalCache.Invalidate();
 }
 
 //with bool
@@ -1321,6 +1629,88 @@ void dae::Renderer::ToggleNormalMap()
 	{
 		m_NormalMapToggle = false;
 	}
+	m_TemporalCache.Invalidate();
+}
+
+void dae::Renderer::ToggleTextureFilter()
+{
+	m_TextureFilter = TextureFilter((int(m_TextureFilter) + 1) % 4);
+	m_TemporalCache.Invalidate();
+}
+
+void dae::Renderer::ToggleVirtualTexture()
+{
+	m_VirtualTextureToggle = !m_VirtualTextureToggle;
+	m_TemporalCache.Invalidate();
+}
+
+void dae::Renderer::ToggleSpecularPower()
+{
+	m_SpecularPowerMode = SpecularPowerMode((int(m_SpecularPowerMode) + 1) % 3);
+	m_TemporalCache.Invalidate();
+}
+
+void dae::Renderer::ToggleTangentSpaceLighting()
+{
+	m_TangentSpaceLightingToggle = !m_TangentSpaceLightingToggle;
+	m_TemporalCache.Invalidate();
+}
+
+void dae::Renderer::ToggleLocalLights()
+{
+	m_LocalLightsToggle = !m_LocalLightsToggle;
+	m_TemporalCache.Invalidate();
+}
+
+void dae::Renderer::ToggleShadows()
+{
+	m_ShadowFilter = ShadowFilter((int(m_ShadowFilter) + 1) % 3);
+	m_TemporalCache.Invalidate();
+}
+
+void dae::Renderer::ToggleMultisample()
+{
+	m_MultisampleToggle = !m_MultisampleToggle;
+}
+
+void dae::Renderer::ToggleShadingRate()
+{
+	m_ShadingRateMode = ShadingRateMode((int(m_ShadingRateMode) + 1) % 3);
+}
+
+const char* dae::Renderer::GetShadingRateModeName(ShadingRateMode mode)
+{
+	switch (mode)
+	{
+	case ShadingRateMode::perMaterial:
+		return "per material";
+	case ShadingRateMode::periphery:
+		return "coarse periphery";
+	case ShadingRateMode::full:
+	default:
+		return "full";
+	}
+}
+
+void dae::Renderer::ToggleTemporalCache()
+{
+	m_TemporalCacheToggle = !m_TemporalCacheToggle;
+}
+
+void dae::Renderer::ToggleOcclusionCulling()
+{
+	m_OcclusionCullingToggle = !m_OcclusionCullingToggle;
+}
+
+void dae::Renderer::ToggleMeshletCulling()
+{
+	m_MeshletCullingToggle = !m_MeshletCullingToggle;
+}
+
+void dae::Renderer::ToggleDynamicResolution()
+{
+	m_DynamicResolutionToggle = !m_DynamicResolutionToggle;
+	m_DynamicResolution.Reset();
 }
 
 void dae::Renderer::ToggleRotation()
@@ -3,9 +3,23 @@
 #include <cstdint>
 #include <vector>
 
+#include "AssetLoader.h"
 #include "Camera.h"
 #include "DataTypes.h"
+#include "DynamicResolution.h"
+#include "FrameArena.h"
+#include "Light.h"
+#include "LightCulling.h"
+#include "Material.h"
+#include "MeshBVH.h"
+#include "OcclusionCulling.h"
+#include "Pipeline.h"
+#include "ShadowMap.h"
+#include "SpecularPower.h"
+#include "TemporalCache.h"
+#include "Texture.h"
 
+#include <future>
 #include <memory>
 
 
@@ -15,10 +29,21 @@ struct SDL_Surface;
 namespace dae
 {
 	class Texture;
+	class PackedMaterial;
+	class VirtualTexture;
 	struct Mesh;
 	struct Vertex;
 	class Timer;
 	class Scene;
+	class ThreadPool;
+
+	//full: every pixel shaded
+	//perMaterial: every shader variant has its own rate, coarser for smoother results
+	//periphery: full rate around the center of the screen, 2x2 further out
+	enum class ShadingRateMode
+	{
+		full, perMaterial, periphery
+	};
 
 	class Renderer final
 	{
@@ -41,16 +66,110 @@ namespace dae
 		void ToggleRenderOutput();
 		void ToggleNormalMap();
 		void ToggleRotation();
+		void ToggleTextureFilter();
+		void ToggleVirtualTexture();
+		void ToggleSpecularPower();
+		void ToggleTangentSpaceLighting();
+		void ToggleLocalLights();
+		void ToggleShadows();
+		void ToggleMultisample();
+		bool IsMultisampleOn() const { return m_MultisampleToggle; }
+		void ToggleDynamicResolution();
+		void ToggleShadingRate();
+		void ToggleTemporalCache();
+		void ToggleOcclusionCulling();
+		bool IsOcclusionCullingOn() const { return m_OcclusionCullingToggle; }
+		void ToggleMeshletCulling();
+		bool IsMeshletCullingOn() const { return m_MeshletCullingToggle; }
+		bool IsTemporalCacheOn() const { return m_TemporalCacheToggle; }
+		ShadingRateMode GetShadingRateMode() const { return m_ShadingRateMode; }
+		static const char* GetShadingRateModeName(ShadingRateMode mode);
+		bool IsDynamicResolutionOn() const { return m_DynamicResolutionToggle; }
+		ShadowFilter GetShadowFilter() const { return m_ShadowFilter; }
+		SpecularPowerMode GetSpecularPowerMode() const { return m_SpecularPowerMode; }
+		const SpecularPower& GetSpecularPower() const { return m_SpecularPower; }
+
+		struct FrameStats
+		{
+			size_t arenaUsed{};
+			size_t arenaHighWaterMark{};
+			uint64_t heapAllocations{};
+			//summed over the virtual textures
+			uint32_t virtualPagesResident{};
+			uint32_t virtualPageLoads{};
+			uint32_t virtualPagesMissing{};
+			//tiled light culling, 0 when the local lights are off
+			uint32_t lightTileAssignments{};
+			uint32_t lightTileCount{};
+			uint32_t lightsDroppedFromTiles{};
+			//since startup, only goes up when the light or a mesh moved
+			uint32_t shadowMapRenders{};
+			//meshes with something on screen, drawn or skipped by the occlusion test, and the ones outside the view (frustum or screen)
+			uint32_t meshesDrawn{};
+			uint32_t meshesOccluded{};
+			uint32_t meshesFrustumCulled{};
+			//meshlets of the drawn meshes, 0 when meshlet culling is off
+			uint32_t meshletsDrawn{};
+			uint32_t meshletsCulled{};
+			//pixels the temporal cache took from the last frame / shaded, 0 when it is off
+			uint32_t temporalReusedPixels{};
+			uint32_t temporalShadedPixels{};
+			//the viewport the frame was rendered at
+			int renderWidth{};
+			int renderHeight{};
+		};
+		const FrameStats& GetFrameStats() const { return m_FrameStats; }
+
 	private:
+		enum class RenderState
+		{
+			observedArea, lambert, phong, combined
+		};
 
 		SDL_Surface* m_pFrontBuffer{ nullptr };
 		SDL_Surface* m_pBackBuffer{ nullptr };
 		uint32_t* m_pBackBufferPixels{};
 
+		//sampled until the packed material is built, released then (it holds the same blocks)
 		std::unique_ptr<Texture> m_pDiffuseTexture{ nullptr };
 		std::unique_ptr<Texture> m_pNormalTexture{ nullptr };
 		std::unique_ptr<Texture> m_pGlossTexture{ nullptr };
 		std::unique_ptr<Texture> m_pSpecularTexture{ nullptr };
+		std::unique_ptr<PackedMaterial> m_pPackedMaterial{ nullptr };
+		//same 4 maps, paged from disk with a fixed memory budget each
+		std::unique_ptr<VirtualTexture> m_pVirtualDiffuse{ nullptr };
+		std::unique_ptr<VirtualTexture> m_pVirtualNormal{ nullptr };
+		std::unique_ptr<VirtualTexture> m_pVirtualGloss{ nullptr };
+		std::unique_ptr<VirtualTexture> m_pVirtualSpecular{ nullptr };
+
+		std::unique_ptr<ThreadPool> m_pThreadPool{ nullptr };
+		std::unique_ptr<AssetLoader> m_pAssetLoader{ nullptr };
+
+		//assets still loading, the members above hold placeholders until a future is taken
+		std::future<std::unique_ptr<Texture>> m_DiffuseTextureLoad{};
+		std::future<std::unique_ptr<Texture>> m_NormalTextureLoad{};
+		std::future<std::unique_ptr<Texture>> m_GlossTextureLoad{};
+		std::future<std::unique_ptr<Texture>> m_SpecularTextureLoad{};
+		std::future<std::unique_ptr<VirtualTexture>> m_VirtualDiffuseLoad{};
+		std::future<std::unique_ptr<VirtualTexture>> m_VirtualNormalLoad{};
+		std::future<std::unique_ptr<VirtualTexture>> m_VirtualGlossLoad{};
+		std::future<std::unique_ptr<VirtualTexture>> m_VirtualSpecularLoad{};
+		std::future<AssetLoader::MeshData> m_MeshLoad{};
+		//built on the thread pool from the 4 maps once they are loaded
+		std::future<std::unique_ptr<PackedMaterial>> m_PackedMaterialBuild{};
+		bool m_IsPackedMaterialBuildStarted{ false };
+		//on the first F10, paged from the texture cache files the map loads wrote (empty when a map is not cached)
+		bool m_IsVirtualTextureLoadStarted{ false };
+		std::string m_DiffuseCacheFile{};
+		std::string m_NormalCacheFile{};
+		std::string m_GlossCacheFile{};
+		std::string m_SpecularCacheFile{};
+
+		//transient per-frame pipeline data (vertices_out, ...), reset at the start of Render
+		FrameArena m_FrameArena{ 16 * 1024 * 1024 };
+		FrameStats m_FrameStats{};
+		uint64_t m_AllocationCountAtFrameStart{};
+		uint32_t m_FrameCount{}; //since the last asset finished loading
 		
 
 		float* m_pDepthBufferPixels{};
@@ -65,6 +184,44 @@ namespace dae
 		int m_ColorOutput{0};
 		bool m_NormalMapToggle{true};
 		bool m_RotationToggle{true};
+		TextureFilter m_TextureFilter{ TextureFilter::point };
+		bool m_VirtualTextureToggle{ false };
+		//phong exponent = gloss * shininess (25)
+		SpecularPower m_SpecularPower{ 25.f };
+		SpecularPowerMode m_SpecularPowerMode{ SpecularPowerMode::lookupTable };
+		//light and view direction go to tangent space per vertex instead of the normal to world space per pixel
+		bool m_TangentSpaceLightingToggle{ false };
+		//directional light, the direction it travels in
+		Vector3 m_LightDirection{ .577f, -.577f, .577f };
+		//point, spot and directional lights on top of it, assigned to screen tiles every frame
+		std::vector<Light> m_Lights{};
+		TiledLightCulling m_LightCulling{};
+		bool m_LocalLightsToggle{ false };
+		//cast by the main light
+		ShadowMap m_ShadowMap{ 512 };
+		ShadowFilter m_ShadowFilter{ ShadowFilter::off };
+		//4x MSAA: 4 depths + 4 colors per pixel, resolved into the back buffer at the end of the frame
+		bool m_MultisampleToggle{ false };
+		std::vector<float> m_SampleDepthBuffer{};
+		std::vector<uint32_t> m_SampleColorBuffer{};
+		//the frame is rendered smaller to stay at the target frame time and stretched over the back buffer at the end
+		//m_ScaledColorBuffer and the depth buffers keep the window size, only the front part is used (width x height of the viewport)
+		bool m_DynamicResolutionToggle{ false };
+		DynamicResolution m_DynamicResolution{ 1.f / 60.f };
+		std::vector<uint32_t> m_ScaledColorBuffer{};
+		ShadingRateMode m_ShadingRateMode{ ShadingRateMode::full };
+		//reuses last frame's shading where the surface did not change, matrices of the last frame to reproject with
+		bool m_TemporalCacheToggle{ false };
+		TemporalCache m_TemporalCache{};
+		Matrix m_PreviousViewProjection{};
+		std::vector<Matrix> m_PreviousWorldMatrices{};
+		//meshes hidden behind the ones drawn before them are skipped
+		bool m_OcclusionCullingToggle{ true };
+		OcclusionCuller m_OcclusionCuller{};
+		//world-space bounds of the meshes for frustum culling, rebuilt every frame
+		MeshBVH m_MeshBVH{};
+		//meshlets outside the view or facing away skip the vertex stage
+		bool m_MeshletCullingToggle{ true };
 
 		//triangle worldSpace
 		std::vector<Mesh> m_Meshes =
@@ -83,7 +240,7 @@ namespace dae
 		
 
 		//Function that transforms the vertices from the mesh from World space to Screen space
-		void VertexTransformationFunction(Mesh& mesh) const; //W1 Version
+		void VertexTransformationFunction(Mesh& mesh); //W1 Version
 		bool IsInTriangle(const std::vector<Vector2>& verticesScreenspace, const Vector2& pixelPos);
 		void render_W1_Part1();
 		void render_W1_Part2();
@@ -98,18 +255,87 @@ namespace dae
 		void render_W4_Part1();
 
 		float Remap(float value, float minValue, float maxValue);
-		bool FustrumCulling(const Vector3 v0, const Vector3 v1, const Vector3 v2);
-		void ToScreenSpace(Vector4& v0, Vector4& v1, Vector4& v2);
 
-		void BoundingBox(Vector2& topLeft, Vector2& bottomRight, std::vector<Vector2> v);
+		void BoundingBox(Vector2& topLeft, Vector2& bottomRight, const Vector2 (&v)[3]);
+		void UpdateFrameStats();
+		void UpdateVirtualTextures();
+		void UpdateAssetLoading();
+		bool IsLoadingAssets() const;
+		void LoadVirtualTextures();
+		static std::vector<Light> CreateSceneLights();
 		
 
-		ColorRGB PixelShading(const Vertex_Out& v);
+		//one raster loop + pixel shader per (render state, normal mapping, lighting space) variant, render_W4_Part1 picks one per frame
+		//tangentSpaceLighting only changes anything together with useNormalMap
+		template<RenderState renderState, bool useNormalMap, bool tangentSpaceLighting>
+		void RasterizeShaded();
+		template<RenderState renderState, bool useNormalMap, bool tangentSpaceLighting, typename Varying>
+		ColorRGB PixelShading(const Varying& v, const UVDerivatives& uvDerivatives, bool hasLocalLights, bool hasShadows) const;
+		template<bool withSpecular, typename Varying>
+		ColorRGB ShadeLocalLights(const Varying& v, const Vector3& normal, const ColorRGB& lambertDiffuse, const MaterialSample& material) const;
+		template<uint32_t channels>
+		MaterialSample SampleMaterial(const Vector2& uv, const UVDerivatives& uvDerivatives) const;
 
-		enum class RenderState
+		//material channels a shader variant reads
+		template<RenderState renderState, bool useNormalMap>
+		static constexpr uint32_t GetShaderChannels()
 		{
-			observedArea, lambert, phong, combined
+			constexpr bool needsDiffuse{ renderState == RenderState::lambert || renderState == RenderState::combined };
+			constexpr bool needsSpecular{ renderState == RenderState::phong || renderState == RenderState::combined };
+			return (needsDiffuse ? MaterialChannel::diffuse : 0u) | (useNormalMap ? MaterialChannel::normal : 0u)
+				| (needsSpecular ? MaterialChannel::gloss | MaterialChannel::specular : 0u);
+		}
+
+		//pixel shader policy for DrawMesh, forwards to the PixelShading variant
+		template<RenderState renderState, bool useNormalMap, bool tangentSpaceLighting>
+		struct VehiclePixelShader
+		{
+			static constexpr bool isTangentSpace{ useNormalMap && tangentSpaceLighting };
+			static constexpr bool needsView{ renderState == RenderState::phong || renderState == RenderState::combined };
+			//the local lights are lit in world space, observedArea only shows the main light
+			static constexpr bool supportsLocalLights{ renderState != RenderState::observedArea && !isTangentSpace };
+			static constexpr bool supportsShadows{ renderState != RenderState::observedArea };
+			//ShadingRateMode::perMaterial: observedArea is only the cosine law, lambert keeps the texture detail along one axis,
+			//specular highlights need every pixel
+			static constexpr ShadingRate materialShadingRate
+			{
+				renderState == RenderState::observedArea ? ShadingRate::rate2x2 : (renderState == RenderState::lambert ? ShadingRate::rate2x1 : ShadingRate::rate1x1)
+			};
+
+			//uv when a texture is sampled, then either
+			//world space: normal, tangent for normal mapping, viewDirection for specular
+			//worldPosition for the local lights and the shadow map
+			//tangent space: the light direction, the view direction for specular
+			static constexpr uint32_t varyingAttributes
+			{
+				(GetShaderChannels<renderState, useNormalMap>() != 0 ? VaryingAttribute::uv : 0u)
+				| (isTangentSpace
+					? VaryingAttribute::tangentLightDirection | (needsView ? VaryingAttribute::tangentViewDirection : 0u)
+					: VaryingAttribute::normal | (useNormalMap ? VaryingAttribute::tangent : 0u) | (needsView ? VaryingAttribute::viewDirection : 0u))
+				| (supportsLocalLights || supportsShadows ? VaryingAttribute::worldPosition : 0u)
+			};
+
+			const Renderer& renderer;
+			//the light culling was built for this frame
+			bool hasLocalLights;
+			//the shadow map is valid and filtering is on
+			bool hasShadows;
+
+			bool NeedsUVDerivatives() const
+			{
+				//only the mip filters use them, and only when the variant samples a texture
+				return GetShaderChannels<renderState, useNormalMap>() != 0 &&
+					(renderer.m_TextureFilter == TextureFilter::nearestMip || renderer.m_TextureFilter == TextureFilter::trilinear);
+			}
+
+			//any varying with at least varyingAttributes (TemporalPixelShader adds previousPosition)
+			template<typename Varying>
+			ColorRGB Shade(const Varying& v, const UVDerivatives& uvDerivatives) const
+			{
+				return renderer.PixelShading<renderState, useNormalMap, tangentSpaceLighting>(v, uvDerivatives, hasLocalLights, hasShadows);
+			}
 		};
+		RenderTarget GetRenderTarget();
 
 		RenderState m_CurrentRenderState;
 
@@ -0,0 +1,262 @@
+#include "ShadowMap.h"
+
+#include <cfloat>
+#include <immintrin.h>
+
+#include "FrameArena.h"
+#include "ThreadPool.h"
+#include "VertexKernel.h"
+
+using namespace dae;
+
+namespace
+{
+	//edge functions already divided by the area, so they are the barycentric weights of vertex 1 and 2
+	//depth is linear in screen space (orthographic), a plane as well
+	struct TriangleSetup
+	{
+		float weight1X, weight1Y, weight1C;
+		float weight2X, weight2Y, weight2C;
+		float depthX, depthY, depthC;
+		int minX, minY, maxX, maxY;
+	};
+
+	bool IsSameMatrix(const Matrix& a, const Matrix& b)
+	{
+		for (int r{}; r < 4; ++r)
+		{
+			const Vector4 rowA{ a[r] };
+			const Vector4 rowB{ b[r] };
+			if (rowA.x != rowB.x || rowA.y != rowB.y || rowA.z != rowB.z || rowA.w != rowB.w) return false;
+		}
+		return true;
+	}
+
+	//pixel centers, size is a multiple of 4
+	bool SetupTriangle(Vector4 p0, Vector4 p1, Vector4 p2, int size, TriangleSetup& setup)
+	{
+		const auto toTexels = [size](Vector4& p)
+		{
+			p.x = (p.x + 1) / 2 * float(size);
+			p.y = (1 - p.y) / 2 * float(size);
+		};
+		toTexels(p0);
+		toTexels(p1);
+		toTexels(p2);
+
+		//both windings cast
+		const float area{ (p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x) };
+		if (area == 0.f) return false;
+		const float invArea{ 1.f / area };
+
+		setup.minX = std::max(static_cast<int>(std::min({ p0.x, p1.x, p2.x })), 0);
+		setup.minY = std::max(static_cast<int>(std::min({ p0.y, p1.y, p2.y })), 0);
+		setup.maxX = std::min(static_cast<int>(std::max({ p0.x, p1.x, p2.x })), size - 1);
+		setup.maxY = std::min(static_cast<int>(std::max({ p0.y, p1.y, p2.y })), size - 1);
+		if (setup.minX > setup.maxX || setup.minY > setup.maxY) return false;
+
+		//p = p0 + weight1 * (p1 - p0) + weight2 * (p2 - p0), both weights written as a * x + b * y + c
+		setup.weight1X = (p2.y - p0.y) * invArea;
+		setup.weight1Y = -(p2.x - p0.x) * invArea;
+		setup.weight1C = (p0.y * (p2.x - p0.x) - p0.x * (p2.y - p0.y)) * invArea;
+		setup.weight2X = -(p1.y - p0.y) * invArea;
+		setup.weight2Y = (p1.x - p0.x) * invArea;
+		setup.weight2C = (p0.x * (p1.y - p0.y) - p0.y * (p1.x - p0.x)) * invArea;
+
+		//z = z0 + weight1 * (z1 - z0) + weight2 * (z2 - z0)
+		const float dz1{ p1.z - p0.z };
+		const float dz2{ p2.z - p0.z };
+		setup.depthX = setup.weight1X * dz1 + setup.weight2X * dz2;
+		setup.depthY = setup.weight1Y * dz1 + setup.weight2Y * dz2;
+		setup.depthC = p0.z + setup.weight1C * dz1 + setup.weight2C * dz2;
+		return true;
+	}
+
+	//rows [bandMinY, bandMaxY] of one triangle, 4 texels per step
+	void RasterizeTriangleDepth(const TriangleSetup& setup, int bandMinY, int bandMaxY, float* pDepth, int size)
+	{
+		const int minY{ std::max(setup.minY, bandMinY) };
+		const int maxY{ std::min(setup.maxY, bandMaxY) };
+		const int minX{ setup.minX & ~3 };
+
+		const __m128 zero{ _mm_setzero_ps() };
+		const __m128 one{ _mm_set1_ps(1.f) };
+		const __m128 laneOffsets{ _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f) };
+		const __m128 weight1X{ _mm_set1_ps(setup.weight1X) };
+		const __m128 weight2X{ _mm_set1_ps(setup.weight2X) };
+		const __m128 depthX{ _mm_set1_ps(setup.depthX) };
+
+		for (int y{ minY }; y <= maxY; ++y)
+		{
+			const float centerY{ float(y) + 0.5f };
+			const __m128 weight1Row{ _mm_set1_ps(setup.weight1Y * centerY + setup.weight1C) };
+			const __m128 weight2Row{ _mm_set1_ps(setup.weight2Y * centerY + setup.weight2C) };
+			const __m128 depthRow{ _mm_set1_ps(setup.depthY * centerY + setup.depthC) };
+			float* pRow{ pDepth + static_cast<size_t>(y) * size };
+
+			for (int x{ minX }; x <= setup.maxX; x += 4)
+			{
+				const __m128 centerX{ _mm_add_ps(_mm_set1_ps(float(x)), laneOffsets) };
+				const __m128 weight1{ _mm_add_ps(_mm_mul_ps(weight1X, centerX), weight1Row) };
+				const __m128 weight2{ _mm_add_ps(_mm_mul_ps(weight2X, centerX), weight2Row) };
+				const __m128 weight0{ _mm_sub_ps(_mm_sub_ps(one, weight1), weight2) };
+
+				__m128 mask{ _mm_and_ps(_mm_cmpge_ps(weight0, zero), _mm_and_ps(_mm_cmpge_ps(weight1, zero), _mm_cmpge_ps(weight2, zero))) };
+				if (_mm_movemask_ps(mask) == 0) continue;
+
+				//depth test + write in one blend
+				const __m128 depth{ _mm_add_ps(_mm_mul_ps(depthX, centerX), depthRow) };
+				const __m128 stored{ _mm_loadu_ps(pRow + x) };
+				mask = _mm_and_ps(mask, _mm_cmplt_ps(depth, stored));
+				_mm_storeu_ps(pRow + x, _mm_or_ps(_mm_and_ps(mask, depth), _mm_andnot_ps(mask, stored)));
+			}
+		}
+	}
+}
+
+ShadowMap::ShadowMap(int size) :
+	m_Size{ (size + 3) & ~3 },
+	m_Depth(static_cast<size_t>(m_Size) * m_Size, FLT_MAX)
+{
+}
+
+bool ShadowMap::Update(const std::vector<Mesh>& meshes, const Vector3& lightDirection, FrameArena& frameArena, ThreadPool& threadPool)
+{
+	if (m_IsValid && IsUpToDate(meshes, lightDirection)) return false;
+
+	Render(meshes, lightDirection, frameArena, threadPool);
+
+	m_RenderedLightDirection = lightDirection;
+	m_RenderedWorldMatrices.resize(meshes.size());
+	m_RenderedIndexCounts.resize(meshes.size());
+	for (size_t i{}; i < meshes.size(); ++i)
+	{
+		m_RenderedWorldMatrices[i] = meshes[i].worldMatrix;
+		m_RenderedIndexCounts[i] = meshes[i].indices.size();
+	}
+	return true;
+}
+
+bool ShadowMap::IsUpToDate(const std::vector<Mesh>& meshes, const Vector3& lightDirection) const
+{
+	if (lightDirection.x != m_RenderedLightDirection.x || lightDirection.y != m_RenderedLightDirection.y || lightDirection.z != m_RenderedLightDirection.z) return false;
+	if (meshes.size() != m_RenderedWorldMatrices.size()) return false;
+
+	for (size_t i{}; i < meshes.size(); ++i)
+	{
+		//a mesh that finished loading changes its index count
+		if (meshes[i].indices.size() != m_RenderedIndexCounts[i]) return false;
+		if (!IsSameMatrix(meshes[i].worldMatrix, m_RenderedWorldMatrices[i])) return false;
+	}
+	return true;
+}
+
+void ShadowMap::Render(const std::vector<Mesh>& meshes, const Vector3& lightDirection, FrameArena& frameArena, ThreadPool& threadPool)
+{
+	//light view: looking along the light, up is any axis perpendicular to it
+	const Vector3 forward{ lightDirection.Normalized() };
+	const Vector3 helperUp{ fabsf(forward.y) > 0.99f ? Vector3::UnitZ : Vector3::UnitY };
+	const Vector3 right{ Vector3::Cross(helperUp, forward).Normalized() };
+	const Vector3 up{ Vector3::Cross(forward, right) };
+	const Matrix lightView{ Matrix::CreateLookAtLH(Vector3::Zero, forward, up) };
+
+	//fit the orthographic projection around the world-space bounds of every caster
+	Vector3 boundsMin{ FLT_MAX, FLT_MAX, FLT_MAX };
+	Vector3 boundsMax{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (const Mesh& mesh : meshes)
+	{
+		if (mesh.meshlets.empty()) continue;
+
+		const Matrix toLight{ mesh.worldMatrix * lightView };
+		for (int corner{}; corner < 8; ++corner)
+		{
+			const Vector3 point{ toLight.TransformPoint(mesh.bounds.GetCorner(corner)) };
+			boundsMin = { std::min(boundsMin.x, point.x), std::min(boundsMin.y, point.y), std::min(boundsMin.z, point.z) };
+			boundsMax = { std::max(boundsMax.x, point.x), std::max(boundsMax.y, point.y), std::max(boundsMax.z, point.z) };
+		}
+	}
+
+	std::fill(m_Depth.begin(), m_Depth.end(), FLT_MAX);
+	++m_RenderCount;
+
+	if (boundsMin.x > boundsMax.x)
+	{
+		m_IsValid = false;
+		return;
+	}
+
+	//x, y to [-1, 1], depth to [0, 1]
+	const float width{ std::max(boundsMax.x - boundsMin.x, FLT_EPSILON) };
+	const float height{ std::max(boundsMax.y - boundsMin.y, FLT_EPSILON) };
+	const float depth{ std::max(boundsMax.z - boundsMin.z, FLT_EPSILON) };
+	const Matrix orthographic
+	{
+		Vector4{ 2.f / width, 0.f, 0.f, 0.f },
+		Vector4{ 0.f, 2.f / height, 0.f, 0.f },
+		Vector4{ 0.f, 0.f, 1.f / depth, 0.f },
+		Vector4{ -(boundsMin.x + boundsMax.x) / width, -(boundsMin.y + boundsMax.y) / height, -boundsMin.z / depth, 1.f }
+	};
+	m_LightViewProjection = lightView * orthographic;
+
+	for (const Mesh& mesh : meshes)
+	{
+		if (!mesh.meshlets.empty()) RasterizeMesh(mesh, frameArena, threadPool);
+	}
+	m_IsValid = true;
+}
+
+void ShadowMap::RasterizeMesh(const Mesh& mesh, FrameArena& frameArena, ThreadPool& threadPool)
+{
+	//positions only, w stays 1 so the kernel's divide does nothing
+	const VertexKernelConstants constants{ mesh.worldMatrix * m_LightViewProjection, mesh.worldMatrix, Vector3::Zero, Vector3::Zero };
+	ArenaArray<Varying<0>> positions{ frameArena.AllocateArray<Varying<0>>(mesh.meshletVerticesSoA.count) };
+	Varying<0>* pPositions{ positions.data() };
+
+	constexpr size_t vertexGrainSize{ 4096 };
+	threadPool.ParallelFor(positions.size(), vertexGrainSize, [&](size_t begin, size_t end)
+		{
+			TransformVerticesSIMD(mesh.meshletVerticesSoA, begin, end, constants, pPositions);
+		});
+
+	//triangle setup once, meshlet by meshlet (the winding does not matter)
+	const size_t triangleCount{ mesh.meshletTriangles.size() / 3 };
+	ArenaArray<TriangleSetup> setups{ frameArena.AllocateArray<TriangleSetup>(triangleCount) };
+	ArenaArray<uint8_t> isVisible{ frameArena.AllocateArray<uint8_t>(triangleCount) };
+	TriangleSetup* pSetups{ setups.data() };
+	uint8_t* pIsVisible{ isVisible.data() };
+
+	constexpr size_t meshletGrainSize{ 16 };
+	threadPool.ParallelFor(mesh.meshlets.size(), meshletGrainSize, [&](size_t begin, size_t end)
+		{
+			for (size_t m{ begin }; m < end; ++m)
+			{
+				const Meshlet& meshlet{ mesh.meshlets[m] };
+				const Varying<0>* pMeshletPositions{ pPositions + meshlet.vertexOffset };
+				for (uint32_t t{}; t < meshlet.triangleCount; ++t)
+				{
+					const size_t i{ meshlet.triangleOffset + t };
+					const uint8_t* pTriangle{ &mesh.meshletTriangles[i * 3] };
+					pIsVisible[i] = SetupTriangle(pMeshletPositions[pTriangle[0]].position, pMeshletPositions[pTriangle[1]].position,
+						pMeshletPositions[pTriangle[2]].position, m_Size, pSetups[i]);
+				}
+			}
+		});
+
+	//horizontal bands, every band owns its rows of the map
+	constexpr int bandHeight{ 32 };
+	const int bandCount{ (m_Size + bandHeight - 1) / bandHeight };
+	float* pDepth{ m_Depth.data() };
+	threadPool.ParallelFor(static_cast<size_t>(bandCount), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t band{ begin }; band < end; ++band)
+			{
+				const int bandMinY{ static_cast<int>(band) * bandHeight };
+				const int bandMaxY{ std::min(bandMinY + bandHeight, m_Size) - 1 };
+				for (size_t i{}; i < triangleCount; ++i)
+				{
+					if (!pIsVisible[i] || pSetups[i].maxY < bandMinY || pSetups[i].minY > bandMaxY) continue;
+					RasterizeTriangleDepth(pSetups[i], bandMinY, bandMaxY, pDepth, m_Size);
+				}
+			}
+		});
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "DataTypes.h"
+#include "Math.h"
+
+namespace dae
+{
+	class FrameArena;
+	class ThreadPool;
+
+	//off: no shadows
+	//hard: 1 depth compare
+	//pcf3x3: average of the 3x3 compares around the texel
+	enum class ShadowFilter
+	{
+		off, hard, pcf3x3
+	};
+
+	//Depth of the casters as seen from a directional light, orthographic and fitted around the casters
+	//rendered by its own depth-only rasterizer (4 pixels per SSE step, no attributes, no perspective)
+	//and kept across frames until the light or a caster moves
+	class ShadowMap final
+	{
+	public:
+		//size x size texels, size is rounded up to a multiple of 4
+		explicit ShadowMap(int size);
+
+		//re-renders when the light direction, a world matrix or the mesh list changed since the last render
+		//returns whether it rendered
+		bool Update(const std::vector<Mesh>& meshes, const Vector3& lightDirection, FrameArena& frameArena, ThreadPool& threadPool);
+
+		//1 lit, 0 in shadow
+		float SampleVisibility(const Vector3& worldPosition, ShadowFilter filter) const;
+
+		static const char* GetFilterName(ShadowFilter filter);
+
+		bool IsValid() const { return m_IsValid; }
+		int GetSize() const { return m_Size; }
+		uint32_t GetRenderCount() const { return m_RenderCount; }
+
+	private:
+		//in depth units (0 to 1 over the depth range of the casters), against self-shadowing acne
+		static constexpr float depthBias{ 0.004f };
+
+		int m_Size{};
+		std::vector<float> m_Depth{};
+		Matrix m_LightViewProjection{};
+		bool m_IsValid{ false };
+		uint32_t m_RenderCount{};
+
+		//what the cached depth was rendered with
+		Vector3 m_RenderedLightDirection{};
+		std::vector<Matrix> m_RenderedWorldMatrices{};
+		std::vector<size_t> m_RenderedIndexCounts{};
+
+		bool IsUpToDate(const std::vector<Mesh>& meshes, const Vector3& lightDirection) const;
+		void Render(const std::vector<Mesh>& meshes, const Vector3& lightDirection, FrameArena& frameArena, ThreadPool& threadPool);
+		void RasterizeMesh(const Mesh& mesh, FrameArena& frameArena, ThreadPool& threadPool);
+
+		float CompareDepth(int x, int y, float depth) const
+		{
+			x = std::clamp(x, 0, m_Size - 1);
+			y = std::clamp(y, 0, m_Size - 1);
+			return depth - depthBias <= m_Depth[static_cast<size_t>(y) * m_Size + x] ? 1.f : 0.f;
+		}
+	};
+
+	inline const char* ShadowMap::GetFilterName(ShadowFilter filter)
+	{
+		switch (filter)
+		{
+		case ShadowFilter::hard:
+			return "hard";
+		case ShadowFilter::pcf3x3:
+			return "PCF 3x3";
+		case ShadowFilter::off:
+		default:
+			return "off";
+		}
+	}
+
+	inline float ShadowMap::SampleVisibility(const Vector3& worldPosition, ShadowFilter filter) const
+	{
+		if (filter == ShadowFilter::off || !m_IsValid) return 1.f;
+
+		//outside the map nothing casts
+		const Vector3 lightSpace{ m_LightViewProjection.TransformPoint(worldPosition) };
+		if (lightSpace.x < -1.f || lightSpace.x > 1.f || lightSpace.y < -1.f || lightSpace.y > 1.f) return 1.f;
+		const int x{ static_cast<int>((lightSpace.x + 1.f) * 0.5f * m_Size) };
+		const int y{ static_cast<int>((1.f - lightSpace.y) * 0.5f * m_Size) };
+
+		if (filter == ShadowFilter::hard) return CompareDepth(x, y, lightSpace.z);
+
+		float visibility{};
+		for (int offsetY{ -1 }; offsetY <= 1; ++offsetY)
+		{
+			for (int offsetX{ -1 }; offsetX <= 1; ++offsetX)
+			{
+				visibility += CompareDepth(x + offsetX, y + offsetY, lightSpace.z);
+			}
+		}
+		return visibility * (1.f / 9.f);
+	}
+}
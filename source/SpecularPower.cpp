@@ -0,0 +1,99 @@
+#include "SpecularPower.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace dae
+{
+	SpecularPower::SpecularPower(float maxExponent) :
+		m_MaxExponent{ maxExponent },
+		m_Table(static_cast<size_t>(cosSamples) * glossSamples)
+	{
+		for (int glossIndex{}; glossIndex < glossSamples; ++glossIndex)
+		{
+			const float sqrtGloss{ static_cast<float>(glossIndex) / (glossSamples - 1) };
+			const float exponent{ sqrtGloss * sqrtGloss * m_MaxExponent };
+			for (int cosIndex{}; cosIndex < cosSamples; ++cosIndex)
+			{
+				const float cosAngle{ static_cast<float>(cosIndex) / (cosSamples - 1) };
+				m_Table[static_cast<size_t>(glossIndex) * cosSamples + cosIndex] = powf(cosAngle, exponent);
+			}
+		}
+
+		//table: the bilinear error peaks inside the cells and is largest at low exponents, so it is measured in the
+		//table's own coordinates (cosAngle, sqrt(gloss)) at errorSamplesPerCell points per cell on both axes,
+		//cell boundaries and midpoints included, which also covers the cells next to the powf bands
+		constexpr int errorSamplesPerCell{ 8 };
+		constexpr int cosErrorSamples{ (cosSamples - 1) * errorSamplesPerCell };
+		constexpr int glossErrorSamples{ (glossSamples - 1) * errorSamplesPerCell };
+		const auto getTableError = [this](float cosAngle, float sqrtGloss)
+		{
+			const float gloss{ sqrtGloss * sqrtGloss };
+			return std::abs(EvaluateTable(cosAngle, gloss) - powf(cosAngle, gloss * m_MaxExponent));
+		};
+		int worstCosIndex{};
+		int worstGlossIndex{};
+		for (int glossIndex{}; glossIndex <= glossErrorSamples; ++glossIndex)
+		{
+			for (int cosIndex{}; cosIndex <= cosErrorSamples; ++cosIndex)
+			{
+				const float error{ getTableError(static_cast<float>(cosIndex) / cosErrorSamples, static_cast<float>(glossIndex) / glossErrorSamples) };
+				if (error <= m_TableMaxError) continue;
+				m_TableMaxError = error;
+				worstCosIndex = cosIndex;
+				worstGlossIndex = glossIndex;
+			}
+		}
+		//the peak lies within one grid step of the worst grid point, searched again 16x finer there
+		constexpr int refineSamples{ 16 };
+		for (int glossStep{ -refineSamples }; glossStep <= refineSamples; ++glossStep)
+		{
+			const float sqrtGloss{ (worstGlossIndex + static_cast<float>(glossStep) / refineSamples) / glossErrorSamples };
+			if (sqrtGloss < 0.f || sqrtGloss > 1.f) continue;
+			for (int cosStep{ -refineSamples }; cosStep <= refineSamples; ++cosStep)
+			{
+				const float cosAngle{ (worstCosIndex + static_cast<float>(cosStep) / refineSamples) / cosErrorSamples };
+				if (cosAngle < 0.f || cosAngle > 1.f) continue;
+				m_TableMaxError = std::max(m_TableMaxError, getTableError(cosAngle, sqrtGloss));
+			}
+		}
+
+		//fast path: a bound instead of a measurement, the error of 2^(e * log2(c)) is at most
+		//c^e * (2^(e * log2Error) * (1 + exp2Error) - 1) <= 2^(maxExponent * log2Error) * (1 + exp2Error) - 1
+		//log2Error: absolute, over cosAngle in [0.5, 1] (every other binade has the same mantissa polynomial)
+		//exp2Error: relative, over one period of the fraction polynomial (exponents are <= 0)
+		//float rounding outside the polynomials adds less than 1e-7
+		constexpr int polynomialErrorSamples{ 1 << 16 };
+		double log2Error{};
+		double exp2Error{};
+		for (int i{}; i <= polynomialErrorSamples; ++i)
+		{
+			const float t{ static_cast<float>(i) / polynomialErrorSamples };
+			log2Error = std::max(log2Error, std::abs(static_cast<double>(FastLog2(0.5f + 0.5f * t)) - std::log2(0.5 + 0.5 * static_cast<double>(t))));
+			exp2Error = std::max(exp2Error, std::abs(static_cast<double>(FastExp2(-t)) / std::exp2(-static_cast<double>(t)) - 1.0));
+		}
+		m_FastMaxError = static_cast<float>(std::exp2(m_MaxExponent * log2Error) * (1.0 + exp2Error) - 1.0);
+	}
+
+	float SpecularPower::GetMaxError(SpecularPowerMode mode) const
+	{
+		switch (mode)
+		{
+		case SpecularPowerMode::lookupTable: return m_TableMaxError;
+		case SpecularPowerMode::fastExp2Log2: return m_FastMaxError;
+		case SpecularPowerMode::exact:
+		default: return 0.f;
+		}
+	}
+
+	const char* SpecularPower::GetModeName(SpecularPowerMode mode)
+	{
+		switch (mode)
+		{
+		case SpecularPowerMode::lookupTable: return "lookup table";
+		case SpecularPowerMode::fastExp2Log2: return "fast exp2/log2";
+		case SpecularPowerMode::exact:
+		default: return "powf";
+		}
+	}
+}
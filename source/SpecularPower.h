@@ -0,0 +1,130 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace dae
+{
+	//How PixelShading evaluates the phong term pow(cosAngle, gloss * maxExponent)
+	//exact: powf
+	//lookupTable: bilinear lookup in a 2D table over (cosAngle, gloss)
+	//fastExp2Log2: exp2(exponent * log2(cosAngle)) with polynomial exp2 and log2
+	enum class SpecularPowerMode
+	{
+		exact, lookupTable, fastExp2Log2
+	};
+
+	class SpecularPower final
+	{
+	public:
+		//builds the table and measures the error of every mode
+		explicit SpecularPower(float maxExponent);
+
+		//cosAngle and gloss in [0, 1]
+		float Evaluate(SpecularPowerMode mode, float cosAngle, float gloss) const;
+		float EvaluateTable(float cosAngle, float gloss) const;
+		static float FastPow(float base, float exponent);
+
+		//largest absolute difference to powf, from construction
+		//lookupTable: measured at 8x8 points per table cell and refined around the peak, about 7.3e-3 for maxExponent 25
+		//fastExp2Log2: bound from the errors of the log2 and exp2 polynomials, about 2.9e-4 for maxExponent 25
+		float GetMaxError(SpecularPowerMode mode) const;
+		float GetMaxExponent() const { return m_MaxExponent; }
+		static const char* GetModeName(SpecularPowerMode mode);
+
+	private:
+		static constexpr int cosSamples{ 256 };
+		static constexpr int glossSamples{ 64 };
+		//rows are spaced by sqrt(gloss), low exponents change the curve the most
+
+		float m_MaxExponent{};
+		//glossSamples rows of cosSamples values, both axes include 0 and 1
+		std::vector<float> m_Table{};
+		float m_TableMaxError{};
+		float m_FastMaxError{};
+
+		static float FastLog2(float x);
+		static float FastExp2(float x);
+	};
+
+	inline float SpecularPower::Evaluate(SpecularPowerMode mode, float cosAngle, float gloss) const
+	{
+		switch (mode)
+		{
+		case SpecularPowerMode::lookupTable:
+			return EvaluateTable(cosAngle, gloss);
+		case SpecularPowerMode::fastExp2Log2:
+			return FastPow(cosAngle, gloss * m_MaxExponent);
+		case SpecularPowerMode::exact:
+		default:
+			return powf(cosAngle, gloss * m_MaxExponent);
+		}
+	}
+
+	inline float SpecularPower::EvaluateTable(float cosAngle, float gloss) const
+	{
+		gloss = gloss < 0.f ? 0.f : gloss > 1.f ? 1.f : gloss;
+		if (cosAngle <= 0.f) return gloss == 0.f ? 1.f : 0.f;
+
+		const float x{ (cosAngle > 1.f ? 1.f : cosAngle) * (cosSamples - 1) };
+		const float y{ std::sqrt(gloss) * (glossSamples - 1) };
+
+		//next to cosAngle 0 and exponent 0 the curve is too steep to interpolate, these are rare
+		if (x < 1.f || y < 1.f) return powf(cosAngle, gloss * m_MaxExponent);
+
+		//the last sample is only ever read as x1/y1
+		const int x0{ x >= cosSamples - 1 ? cosSamples - 2 : static_cast<int>(x) };
+		const int y0{ y >= glossSamples - 1 ? glossSamples - 2 : static_cast<int>(y) };
+		const float fracX{ x - x0 };
+		const float fracY{ y - y0 };
+
+		const float* pRow0{ &m_Table[static_cast<size_t>(y0) * cosSamples + x0] };
+		const float* pRow1{ pRow0 + cosSamples };
+		const float top{ pRow0[0] + (pRow0[1] - pRow0[0]) * fracX };
+		const float bottom{ pRow1[0] + (pRow1[1] - pRow1[0]) * fracX };
+		return top + (bottom - top) * fracY;
+	}
+
+	inline float SpecularPower::FastLog2(float x)
+	{
+		//x = 2^e * m, m in [1, 2): log2(x) = e + log2(m), log2(m) = t * p(t) with t = m - 1, max error 1.7e-5
+		uint32_t bits{};
+		std::memcpy(&bits, &x, sizeof(bits));
+		const float exponent{ static_cast<float>(static_cast<int>(bits >> 23) - 127) };
+		bits = (bits & 0x007fffff) | 0x3f800000;
+		float mantissa{};
+		std::memcpy(&mantissa, &bits, sizeof(mantissa));
+
+		const float t{ mantissa - 1.f };
+		const float p{ 1.44187990f + t * (-0.70886522f + t * (0.41524556f + t * (-0.19351652f + t * 0.04526829f))) };
+		return exponent + t * p;
+	}
+
+	inline float SpecularPower::FastExp2(float x)
+	{
+		//x = i + f, f in [0, 1): 2^x = 2^i * (1 + f * p(f)), relative error 3e-6, x is clamped to the normal range
+		x = x < -126.f ? -126.f : x > 127.f ? 127.f : x;
+
+		//floor without a libm call
+		const int truncated{ static_cast<int>(x) };
+		const int integer{ x < static_cast<float>(truncated) ? truncated - 1 : truncated };
+		const float f{ x - static_cast<float>(integer) };
+		const float p{ 0.69304401f + f * (0.24128269f + f * (0.05224090f + f * 0.01342655f)) };
+		const float fraction{ 1.f + f * p };
+
+		uint32_t bits{};
+		std::memcpy(&bits, &fraction, sizeof(bits));
+		bits += static_cast<uint32_t>(integer) << 23;
+		float result{};
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	inline float SpecularPower::FastPow(float base, float exponent)
+	{
+		//same special cases as powf for the inputs PixelShading produces, selects instead of branches
+		const float result{ FastExp2(exponent * FastLog2(base)) };
+		return exponent == 0.f ? 1.f : base <= 0.f ? 0.f : result;
+	}
+}
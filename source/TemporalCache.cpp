@@ -0,0 +1,39 @@
+#include "TemporalCache.h"
+
+#include <algorithm>
+
+using namespace dae;
+
+void TemporalCache::BeginFrame(int width, int height)
+{
+	m_Current = 1 - m_Current;
+	++m_FrameIndex;
+	m_ReusedCount = 0;
+	m_ShadedCount = 0;
+
+	if (width != m_Width || height != m_Height)
+	{
+		m_Width = width;
+		m_Height = height;
+		const size_t pixelCount{ static_cast<size_t>(width) * height };
+		for (Frame& frame : m_Frames)
+		{
+			frame.color.assign(pixelCount, ColorRGB{});
+			frame.viewDepth.assign(pixelCount, 0.f);
+			frame.objectId.assign(pixelCount, noObject);
+		}
+		m_IsNextHistoryValid = false;
+	}
+
+	m_IsHistoryValid = m_IsNextHistoryValid;
+	m_IsNextHistoryValid = true;
+
+	//pixels nothing is drawn on this frame
+	std::fill(m_Frames[m_Current].objectId.begin(), m_Frames[m_Current].objectId.end(), noObject);
+}
+
+void TemporalCache::Invalidate()
+{
+	m_IsHistoryValid = false;
+	m_IsNextHistoryValid = false;
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "DataTypes.h"
+#include "Math.h"
+#include "Texture.h"
+
+namespace dae
+{
+	//Shading results of the last frame, reused where a pixel still shows the same surface
+	//a pixel is reprojected into the last frame (previousPosition varying), the old color is taken
+	//when the same object was there at about the same view depth
+	//double buffered: the pixel shader reads the last frame and writes this one
+	class TemporalCache final
+	{
+	public:
+		static constexpr uint16_t noObject{ 0 };
+		//every pixel is shaded again at least once per refreshPeriod frames, one pixel of every 4x4 block per frame
+		static constexpr uint32_t refreshPeriod{ 16 };
+		//relative to the view depth
+		static constexpr float depthTolerance{ 0.01f };
+
+		//swaps the buffers, only allocates when the size changes (the last frame can't be used then)
+		void BeginFrame(int width, int height);
+		//the shading changed for another reason than camera or mesh movement (render mode, lights, textures, ...)
+		//or a frame was drawn without the cache, the next frame shades everything
+		void Invalidate();
+
+		//previousPosition: clip space in the last frame, before the perspective divide (w is the view depth)
+		bool Lookup(int pixelX, int pixelY, const Vector4& previousPosition, uint16_t objectId, ColorRGB& color) const;
+		void Store(int pixelX, int pixelY, uint16_t objectId, float viewDepth, const ColorRGB& color, bool isReused);
+
+		//this frame so far
+		uint32_t GetReusedCount() const { return m_ReusedCount; }
+		uint32_t GetShadedCount() const { return m_ShadedCount; }
+
+	private:
+		struct Frame
+		{
+			std::vector<ColorRGB> color{};
+			std::vector<float> viewDepth{};
+			std::vector<uint16_t> objectId{};
+		};
+
+		Frame m_Frames[2]{};
+		int m_Current{};
+		int m_Width{};
+		int m_Height{};
+		uint32_t m_FrameIndex{};
+		//the last frame can be used this frame / the frame being drawn can be used next frame
+		bool m_IsHistoryValid{ false };
+		bool m_IsNextHistoryValid{ false };
+		uint32_t m_ReusedCount{};
+		uint32_t m_ShadedCount{};
+	};
+
+	inline bool TemporalCache::Lookup(int pixelX, int pixelY, const Vector4& previousPosition, uint16_t objectId, ColorRGB& color) const
+	{
+		if (!m_IsHistoryValid) return false;
+		if (static_cast<uint32_t>((pixelX & 3) + (pixelY & 3) * 4) == m_FrameIndex % refreshPeriod) return false;
+
+		//behind the camera last frame
+		const float viewDepth{ previousPosition.w };
+		if (viewDepth <= 0.f) return false;
+
+		const float screenX{ (previousPosition.x / viewDepth + 1) / 2 * float(m_Width) };
+		const float screenY{ (1 - previousPosition.y / viewDepth) / 2 * float(m_Height) };
+		if (screenX < 0.f || screenY < 0.f || screenX >= float(m_Width) || screenY >= float(m_Height)) return false;
+
+		const Frame& previous{ m_Frames[1 - m_Current] };
+		const size_t index{ static_cast<size_t>(screenY) * m_Width + static_cast<size_t>(screenX) };
+		if (previous.objectId[index] != objectId) return false;
+		if (fabsf(previous.viewDepth[index] - viewDepth) > depthTolerance * viewDepth) return false;
+
+		color = previous.color[index];
+		return true;
+	}
+
+	inline void TemporalCache::Store(int pixelX, int pixelY, uint16_t objectId, float viewDepth, const ColorRGB& color, bool isReused)
+	{
+		Frame& current{ m_Frames[m_Current] };
+		const size_t index{ static_cast<size_t>(pixelY) * m_Width + pixelX };
+		current.objectId[index] = objectId;
+		current.viewDepth[index] = viewDepth;
+		current.color[index] = color;
+		++(isReused ? m_ReusedCount : m_ShadedCount);
+	}
+
+	//Pixel shader policy around another one, reuses the last frame's result through a TemporalCache
+	//needs one Shade call per pixel (full shading rate, no MSAA) and VaryingAttribute::previousPosition
+	template<typename PixelShader>
+	struct TemporalPixelShader
+	{
+		const PixelShader& pixelShader;
+		TemporalCache& cache;
+		//TemporalCache::noObject is reserved for empty pixels
+		uint16_t objectId;
+
+		bool NeedsUVDerivatives() const { return pixelShader.NeedsUVDerivatives(); }
+
+		template<typename Varying>
+		ColorRGB Shade(const Varying& v, const UVDerivatives& uvDerivatives) const
+		{
+			static_assert(Varying::Has(VaryingAttribute::previousPosition), "TemporalPixelShader: the vertex shader has to output previousPosition");
+
+			const int pixelX{ static_cast<int>(v.position.x) };
+			const int pixelY{ static_cast<int>(v.position.y) };
+			ColorRGB color{};
+			const bool isReused{ cache.Lookup(pixelX, pixelY, v.previousPosition, objectId, color) };
+			if (!isReused) color = pixelShader.Shade(v, uvDerivatives);
+
+			cache.Store(pixelX, pixelY, objectId, v.position.w, color, isReused);
+			return color;
+		}
+	};
+}
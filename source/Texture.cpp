@@ -1,79 +1,501 @@
 #include "Texture.h"
-#include "Vector2.h"
 #include <SDL_image.h>
 #include <memory>
 #include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 
 namespace dae
 {
-	Texture::Texture(SDL_Surface* pSurface) :
-		m_pSurface{ pSurface },
-		m_pSurfacePixels{ (uint32_t*)pSurface->pixels }
+	namespace
 	{
+		//texture cache file: header, level table, then the words of every level starting at a 16 byte boundary
+		struct CacheHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t format;
+			uint32_t layout;
+			uint32_t levelCount;
+			uint32_t padding;
+			uint64_t wordCount;
+		};
+
+		struct CacheLevel
+		{
+			int32_t width;
+			int32_t height;
+			int32_t blocksPerRow;
+			int32_t padding;
+			uint64_t offset;
+		};
+
+		constexpr uint32_t cacheMagic{ 0x31435854 }; //"TXC1"
+		//bump when the encoders, mip generation or layouts change, old cache files are then ignored
+		constexpr uint32_t cacheVersion{ 1 };
+
+		size_t GetCacheDataOffset(uint32_t levelCount)
+		{
+			const size_t tableEnd{ sizeof(CacheHeader) + levelCount * sizeof(CacheLevel) };
+			return (tableEnd + 15) & ~size_t{ 15 };
+		}
 	}
 
-	Texture::~Texture()
+	Texture::Texture(SDL_Surface* pSurface, const TextureLoadOptions& options)
 	{
-		if (m_pSurface)
+		if (!pSurface)
+		{
+			//1x1 white placeholder so sampling never has to check for a missing texture
+			m_Levels.push_back({ 1, 1, 0 });
+			m_Data.assign(1, 0xffffffff);
+			FinishBuild();
+			return;
+		}
+
+		//convert once at load, ABGR8888 is a packed format: r in the lowest byte of the uint32 on every platform
+		SDL_Surface* pConverted{ SDL_ConvertSurfaceFormat(pSurface, SDL_PIXELFORMAT_ABGR8888, 0) };
+		SDL_FreeSurface(pSurface);
+
+		if (!pConverted)
+		{
+			std::cout << "surface conversion failed: " << SDL_GetError() << "\n";
+			m_Levels.push_back({ 1, 1, 0 });
+			m_Data.assign(1, 0xffffffff);
+			FinishBuild();
+			return;
+		}
+
+		const int width{ pConverted->w };
+		const int height{ pConverted->h };
+		m_Levels.push_back({ width, height, 0 });
+		m_Data.resize(static_cast<size_t>(width) * height);
+
+		//rows can be padded, copy them one by one
+		SDL_LockSurface(pConverted);
+		for (int y{}; y < height; ++y)
 		{
-			SDL_FreeSurface(m_pSurface);
-			m_pSurface = nullptr;
+			const uint8_t* pRow{ static_cast<const uint8_t*>(pConverted->pixels) + static_cast<size_t>(y) * pConverted->pitch };
+			std::memcpy(&m_Data[static_cast<size_t>(y) * width], pRow, width * sizeof(uint32_t));
 		}
+		SDL_UnlockSurface(pConverted);
+
+		SDL_FreeSurface(pConverted);
+
+		GenerateMipChain();
+
+		if (options.format == TextureFormat::rgba8)
+		{
+			ApplyLayout(options.layout);
+		}
+		else
+		{
+			Compress(options.format);
+		}
+
+		FinishBuild();
 	}
 
-	std::unique_ptr<Texture> Texture::LoadFromFile(const std::string& path)
+	void Texture::FinishBuild()
 	{
-		//TODO
-		//Load SDL_Surface using IMG_LOAD
-		SDL_Surface* data = IMG_Load(path.c_str());
+		m_pWords = m_Data.data();
+		m_WordCount = m_Data.size();
+	}
+
+	void Texture::AddMipLevels()
+	{
+		//halve down to 1x1, linear RGBA8 storage
+		size_t totalTexels{ static_cast<size_t>(m_Levels[0].width) * m_Levels[0].height };
+		for (int width{ m_Levels[0].width }, height{ m_Levels[0].height }; width > 1 || height > 1;)
+		{
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+			m_Levels.push_back({ width, height, totalTexels });
+			totalTexels += static_cast<size_t>(width) * height;
+		}
+		m_Data.resize(totalTexels);
+	}
+
+	void Texture::GenerateMipChain()
+	{
+		//every level is a 2x2 box filter of the previous one
+		AddMipLevels();
+
+		for (size_t level{ 1 }; level < m_Levels.size(); ++level)
+		{
+			const MipLevel& source{ m_Levels[level - 1] };
+			const MipLevel& destination{ m_Levels[level] };
+			const uint32_t* pSource{ m_Data.data() + source.offset };
+			uint32_t* pDestination{ m_Data.data() + destination.offset };
+
+			for (int y{}; y < destination.height; ++y)
+			{
+				//odd sizes: the last row/column is reused instead of reading past the edge
+				const int y0{ std::min(y * 2, source.height - 1) };
+				const int y1{ std::min(y * 2 + 1, source.height - 1) };
+
+				for (int x{}; x < destination.width; ++x)
+				{
+					const int x0{ std::min(x * 2, source.width - 1) };
+					const int x1{ std::min(x * 2 + 1, source.width - 1) };
+
+					const uint32_t texels[4]
+					{
+						pSource[x0 + y0 * source.width], pSource[x1 + y0 * source.width],
+						pSource[x0 + y1 * source.width], pSource[x1 + y1 * source.width]
+					};
+
+					uint32_t average{};
+					for (int channel{}; channel < 4; ++channel)
+					{
+						const int shift{ channel * 8 };
+						uint32_t sum{ 2 }; //round to nearest
+						for (uint32_t texel : texels)
+						{
+							sum += (texel >> shift) & 0xff;
+						}
+						average |= (sum / 4) << shift;
+					}
+					pDestination[x + y * destination.width] = average;
+				}
+			}
+		}
+	}
+
+	size_t Texture::GetLevelSize(TextureLayout layout, int width, int height)
+	{
+		switch (layout)
+		{
+		case TextureLayout::tiled4x4:
+			return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * 16;
+
+		case TextureLayout::morton:
+		{
+			size_t side{ 1 };
+			while (side < static_cast<size_t>(std::max(width, height))) side *= 2;
+			return side * side;
+		}
+
+		case TextureLayout::linear:
+		default:
+			return static_cast<size_t>(width) * height;
+		}
+	}
+
+	void Texture::ApplyLayout(TextureLayout layout)
+	{
+		//mips are generated in linear order, reorder every level once at load
+		if (layout == TextureLayout::linear) return;
+
+		std::vector<MipLevel> levels{ m_Levels };
+		size_t totalTexels{};
+		for (MipLevel& mip : levels)
+		{
+			mip.offset = totalTexels;
+			mip.blocksPerRow = (mip.width + 3) / 4;
+			totalTexels += GetLevelSize(layout, mip.width, mip.height);
+		}
+
+		const std::vector<uint32_t> linearTexels{ std::move(m_Data) };
+		const std::vector<MipLevel> linearLevels{ std::move(m_Levels) };
+
+		//padding texels are never sampled, uv wraps before addressing
+		m_Data.assign(totalTexels, 0);
+		m_Levels = std::move(levels);
+		m_Layout = layout;
+
+		for (size_t level{}; level < m_Levels.size(); ++level)
+		{
+			const MipLevel& linearMip{ linearLevels[level] };
+			for (int y{}; y < linearMip.height; ++y)
+			{
+				for (int x{}; x < linearMip.width; ++x)
+				{
+					m_Data[TexelIndex(m_Levels[level], x, y)] = linearTexels[linearMip.offset + x + static_cast<size_t>(y) * linearMip.width];
+				}
+			}
+		}
+	}
+
+	void Texture::Compress(TextureFormat format)
+	{
+		//mips are generated uncompressed, every level is encoded once at load
+		const int blockWords{ GetBlockWords(format) };
+
+		std::vector<MipLevel> levels{ m_Levels };
+		size_t totalWords{};
+		for (MipLevel& mip : levels)
+		{
+			mip.offset = totalWords;
+			mip.blocksPerRow = (mip.width + 3) / 4;
+			totalWords += static_cast<size_t>(mip.blocksPerRow) * ((mip.height + 3) / 4) * blockWords;
+		}
+
+		std::vector<uint32_t> blocks(totalWords);
+		for (size_t level{}; level < levels.size(); ++level)
+		{
+			const MipLevel& linearMip{ m_Levels[level] };
+			const MipLevel& blockMip{ levels[level] };
+			const int blocksPerColumn{ (linearMip.height + 3) / 4 };
+
+			for (int blockY{}; blockY < blocksPerColumn; ++blockY)
+			{
+				for (int blockX{}; blockX < blockMip.blocksPerRow; ++blockX)
+				{
+					//levels smaller than 4x4 repeat their last row/column
+					uint32_t texels[16];
+					for (int i{}; i < 16; ++i)
+					{
+						const int x{ std::min(blockX * 4 + (i & 3), linearMip.width - 1) };
+						const int y{ std::min(blockY * 4 + (i >> 2), linearMip.height - 1) };
+						texels[i] = m_Data[linearMip.offset + x + static_cast<size_t>(y) * linearMip.width];
+					}
+
+					uint32_t* pBlock{ &blocks[blockMip.offset + (static_cast<size_t>(blockY) * blockMip.blocksPerRow + blockX) * blockWords] };
+					switch (format)
+					{
+					case TextureFormat::bc1:
+						BlockCompression::EncodeBC1Block(texels, pBlock);
+						break;
+					case TextureFormat::bc4:
+						BlockCompression::EncodeBC4Block(texels, 0, pBlock);
+						break;
+					case TextureFormat::bc5:
+					default:
+						BlockCompression::EncodeBC5Block(texels, pBlock);
+						break;
+					}
+				}
+			}
+		}
+
+		m_Data = std::move(blocks);
+		m_Levels = std::move(levels);
+		m_Format = format;
+	}
+
+	std::unique_ptr<Texture> Texture::Generate(int width, int height, const std::function<uint32_t(int, int, int)>& generator, TextureLayout layout)
+	{
+		std::unique_ptr<Texture> pTexture{ new Texture{} };
+		pTexture->m_Levels.push_back({ width, height, 0 });
+		pTexture->AddMipLevels();
+
+		for (size_t level{}; level < pTexture->m_Levels.size(); ++level)
+		{
+			const MipLevel& mip{ pTexture->m_Levels[level] };
+			for (int y{}; y < mip.height; ++y)
+			{
+				for (int x{}; x < mip.width; ++x)
+				{
+					pTexture->m_Data[mip.offset + x + static_cast<size_t>(y) * mip.width] = generator(static_cast<int>(level), x, y);
+				}
+			}
+		}
+
+		pTexture->ApplyLayout(layout);
+		pTexture->FinishBuild();
+		return pTexture;
+	}
+
+	std::unique_ptr<Texture> Texture::InterleaveBlocks(const Texture& first, const Texture& second)
+	{
+		TextureFormat format{};
+		if (first.m_Format == TextureFormat::bc1 && second.m_Format == TextureFormat::bc4) format = TextureFormat::bc1bc4;
+		else if (first.m_Format == TextureFormat::bc5 && second.m_Format == TextureFormat::bc1) format = TextureFormat::bc5bc1;
+		else return nullptr;
+
+		if (first.GetWidth() != second.GetWidth() || first.GetHeight() != second.GetHeight() || first.GetLevelCount() != second.GetLevelCount()) return nullptr;
+
+		const int firstWords{ GetBlockWords(first.m_Format) };
+		const int secondWords{ GetBlockWords(second.m_Format) };
+		const int blockWords{ firstWords + secondWords };
+
+		std::unique_ptr<Texture> pTexture{ new Texture{} };
+		pTexture->m_Format = format;
+		pTexture->m_Levels = first.m_Levels;
+		size_t totalWords{};
+		for (MipLevel& mip : pTexture->m_Levels)
+		{
+			mip.offset = totalWords;
+			totalWords += static_cast<size_t>(mip.blocksPerRow) * ((mip.height + 3) / 4) * blockWords;
+		}
+
+		pTexture->m_Data.resize(totalWords);
+		for (size_t level{}; level < pTexture->m_Levels.size(); ++level)
+		{
+			const MipLevel& mip{ pTexture->m_Levels[level] };
+			const size_t blockCount{ static_cast<size_t>(mip.blocksPerRow) * ((mip.height + 3) / 4) };
+			const uint32_t* pFirst{ first.m_pWords + first.m_Levels[level].offset };
+			const uint32_t* pSecond{ second.m_pWords + second.m_Levels[level].offset };
+			uint32_t* pDestination{ pTexture->m_Data.data() + mip.offset };
+
+			for (size_t block{}; block < blockCount; ++block)
+			{
+				std::copy(pFirst + block * firstWords, pFirst + (block + 1) * firstWords, pDestination + block * blockWords);
+				std::copy(pSecond + block * secondWords, pSecond + (block + 1) * secondWords, pDestination + block * blockWords + firstWords);
+			}
+		}
+
+		pTexture->FinishBuild();
+		return pTexture;
+	}
+
+	std::unique_ptr<Texture> Texture::LoadFromFile(const std::string& path, const TextureLoadOptions& options)
+	{
+		//the file is read once, for the cache key and for the decoder
+		const std::vector<uint8_t> fileData{ ReadFile(path) };
+
+		std::string cachePath{};
+		if (options.useDiskCache && !fileData.empty())
+		{
+			cachePath = GetCachePath(fileData, options);
+			if (std::unique_ptr<Texture> pCached{ MapFromFile(cachePath) }) return pCached;
+		}
+
+		//Load SDL_Surface using IMG_LOAD, the extension is a hint for the decoder like in IMG_Load
+		const std::string extension{ std::filesystem::path{ path }.extension().string() };
+		SDL_Surface* data = fileData.empty() ? nullptr :
+			IMG_LoadTyped_RW(SDL_RWFromConstMem(fileData.data(), static_cast<int>(fileData.size())), 1, extension.empty() ? nullptr : extension.c_str() + 1);
 
 		//Create & Return a new Texture Object (using SDL_Surface)
 		if (data == nullptr)
 		{
 			std::cout << "surface is nullptr" << "\n";
+			return std::make_unique<Texture>(data, options);
 		}
 
-		return std::make_unique<Texture> (data);
-		
+		std::unique_ptr<Texture> pTexture{ std::make_unique<Texture>(data, options) };
+		if (!cachePath.empty())
+		{
+			std::error_code error{};
+			std::filesystem::create_directories(cacheDirectory, error);
+			if (pTexture->SaveToFile(cachePath))
+			{
+				pTexture->m_CacheFile = cachePath;
+			}
+			else
+			{
+				std::cout << "could not write texture cache " << cachePath << "\n";
+			}
+		}
+		return pTexture;
 	}
 
-	ColorRGB Texture::Sample(const Vector2& uv) const
+	std::vector<uint8_t> Texture::ReadFile(const std::string& path)
 	{
-		//TODO
-		//Sample the correct texel for the given uv
-		Uint8 r, g, b;
+		std::vector<uint8_t> fileData{};
+		std::ifstream file{ path, std::ios::binary | std::ios::ate };
+		if (file)
+		{
+			fileData.resize(static_cast<size_t>(file.tellg()));
+			file.seekg(0);
+			file.read(reinterpret_cast<char*>(fileData.data()), static_cast<std::streamsize>(fileData.size()));
+		}
+		return fileData;
+	}
 
-		const Uint32 U{static_cast<Uint32>(uv.x * m_pSurface->w) };
-		const Uint32 V{ static_cast< Uint32>(uv.y * m_pSurface->h) };
-		
-		
-		const Uint32 pixel{ m_pSurfacePixels[static_cast<Uint32>(U + (V * m_pSurface->w))]};
+	uint64_t Texture::HashFile(const std::vector<uint8_t>& fileData)
+	{
+		//FNV-1a, only has to tell source files apart, not resist attacks
+		uint64_t hash{ 0xcbf29ce484222325 };
+		for (uint8_t byte : fileData)
+		{
+			hash = (hash ^ byte) * 0x100000001b3;
+		}
+		return hash;
+	}
+
+	std::string Texture::GetCachePath(const std::vector<uint8_t>& fileData, const TextureLoadOptions& options)
+	{
+		//the same file loaded with other options is another cache entry
+		char name[64]{};
+		std::snprintf(name, sizeof(name), "%016llx_%u_%u_%u.tex", static_cast<unsigned long long>(HashFile(fileData)),
+			static_cast<unsigned>(options.format), static_cast<unsigned>(options.layout), cacheVersion);
+		return std::string{ cacheDirectory } + name;
+	}
+
+	bool Texture::SaveToFile(const std::string& path) const
+	{
+		//written next to the destination first, a crash halfway never leaves a truncated cache file behind
+		const std::string temporaryPath{ path + ".tmp" };
+		{
+			std::ofstream file{ temporaryPath, std::ios::binary | std::ios::trunc };
+			if (!file) return false;
 
-		SDL_GetRGB(pixel, m_pSurface->format, &r, &g, &b);
+			const CacheHeader header{ cacheMagic, cacheVersion, static_cast<uint32_t>(m_Format), static_cast<uint32_t>(m_Layout),
+				static_cast<uint32_t>(m_Levels.size()), 0, m_WordCount };
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
 
-		const float colorRemap{ 1 / 255.f };
+			for (const MipLevel& mip : m_Levels)
+			{
+				const CacheLevel level{ mip.width, mip.height, mip.blocksPerRow, 0, mip.offset };
+				file.write(reinterpret_cast<const char*>(&level), sizeof(level));
+			}
 
+			const size_t tableEnd{ sizeof(CacheHeader) + m_Levels.size() * sizeof(CacheLevel) };
+			const char padding[16]{};
+			file.write(padding, static_cast<std::streamsize>(GetCacheDataOffset(static_cast<uint32_t>(m_Levels.size())) - tableEnd));
+
+			file.write(reinterpret_cast<const char*>(m_pWords), static_cast<std::streamsize>(m_WordCount * sizeof(uint32_t)));
+			if (!file) return false;
+		}
 
-		return { r * colorRemap, g * colorRemap, b * colorRemap };
+		std::error_code error{};
+		std::filesystem::rename(temporaryPath, path, error);
+		return !error;
 	}
 
-	Vector3 Texture::SampleNormal(const Vector2& uv) const
+	std::unique_ptr<Texture> Texture::MapFromFile(const std::string& path)
 	{
-		//TODO
-		//Sample the correct texel for the given uv
-		Uint8 r, g, b;
+		std::unique_ptr<MappedFile> pFile{ MappedFile::Open(path) };
+		if (!pFile || pFile->GetSize() < sizeof(CacheHeader)) return nullptr;
 
-		const Uint32 U{ static_cast<Uint32>(uv.x * m_pSurface->w) };
-		const Uint32 V{ static_cast<Uint32>(uv.y * m_pSurface->h) };
+		CacheHeader header{};
+		std::memcpy(&header, pFile->GetData(), sizeof(header));
+		//a truncated or corrupt file returns nullptr, LoadFromFile then decodes the source image again and rewrites it
+		//32 levels is more than a 2^31 texel side can have
+		if (header.magic != cacheMagic || header.version != cacheVersion || header.levelCount == 0 || header.levelCount > 32) return nullptr;
+		if (header.format > static_cast<uint32_t>(TextureFormat::bc5bc1) || header.layout > static_cast<uint32_t>(TextureLayout::morton)) return nullptr;
 
+		const size_t dataOffset{ GetCacheDataOffset(header.levelCount) };
+		if (pFile->GetSize() < dataOffset || header.wordCount != (pFile->GetSize() - dataOffset) / sizeof(uint32_t)
+			|| pFile->GetSize() != dataOffset + header.wordCount * sizeof(uint32_t)) return nullptr;
 
-		const Uint32 pixel{ m_pSurfacePixels[static_cast<Uint32>(U + (V * m_pSurface->w))] };
+		std::unique_ptr<Texture> pTexture{ new Texture{} };
+		pTexture->m_Format = static_cast<TextureFormat>(header.format);
+		pTexture->m_Layout = static_cast<TextureLayout>(header.layout);
 
-		SDL_GetRGB(pixel, m_pSurface->format, &r, &g, &b);
+		pTexture->m_Levels.reserve(header.levelCount);
+		for (uint32_t i{}; i < header.levelCount; ++i)
+		{
+			CacheLevel level{};
+			std::memcpy(&level, pFile->GetData() + sizeof(CacheHeader) + i * sizeof(CacheLevel), sizeof(level));
+
+			//every texel or block the level can address has to lie inside the mapped words
+			if (level.width <= 0 || level.height <= 0 || level.width > 1 << 16 || level.height > 1 << 16) return nullptr;
+			const bool hasBlocks{ pTexture->m_Format != TextureFormat::rgba8 || pTexture->m_Layout == TextureLayout::tiled4x4 };
+			if (hasBlocks && level.blocksPerRow != (level.width + 3) / 4) return nullptr;
 
-		const float colorRemap{ 1 / 255.f };
+			size_t levelWords{};
+			if (pTexture->m_Format == TextureFormat::rgba8)
+			{
+				levelWords = GetLevelSize(pTexture->m_Layout, level.width, level.height);
+			}
+			else
+			{
+				levelWords = static_cast<size_t>(level.blocksPerRow) * ((level.height + 3) / 4) * GetBlockWords(pTexture->m_Format);
+			}
+			if (level.offset > header.wordCount || levelWords > header.wordCount - level.offset) return nullptr;
 
+			pTexture->m_Levels.push_back({ level.width, level.height, static_cast<size_t>(level.offset), level.blocksPerRow });
+		}
 
-		return { r * colorRemap, g * colorRemap, b * colorRemap };
+		//the texels stay in the mapping, the OS pages them in as they are sampled
+		pTexture->m_pWords = reinterpret_cast<const uint32_t*>(pFile->GetData() + dataOffset);
+		pTexture->m_WordCount = static_cast<size_t>(header.wordCount);
+		pTexture->m_pMappedFile = std::move(pFile);
+		pTexture->m_CacheFile = path;
+		return pTexture;
 	}
-}
\ No newline at end of file
+}
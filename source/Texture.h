@@ -3,25 +3,430 @@
 #include <string>
 #include "ColorRGB.h"
 #include<memory>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+#include <functional>
+#include "Vector2.h"
 #include "Vector3.h"
+#include "Vector4.h"
+#include "BlockCompression.h"
+#include "MappedFile.h"
 
 namespace dae
 {
-	struct Vector2;
+	enum class TextureFilter
+	{
+		point, bilinear, nearestMip, trilinear
+	};
+
+	//Memory order of the texels inside every mip level
+	//linear: row by row
+	//tiled4x4: 4x4 blocks of 16 contiguous texels, blocks row by row (level padded to a multiple of 4)
+	//morton: Z-order curve over the whole level (level padded to a power of 2 square)
+	enum class TextureLayout
+	{
+		linear, tiled4x4, morton
+	};
+
+	//Storage format of every mip level
+	//rgba8: uncompressed, stored in the TextureLayout
+	//bc1: rgb, 4 bits per texel
+	//bc4: single channel (r), 4 bits per texel, decoded as gray
+	//bc5: two channel normal map (x, y), 8 bits per texel, z is reconstructed
+	//bc1bc4: bc1 block followed by a bc4 block for alpha, 8 bits per texel
+	//bc5bc1: bc5 block followed by a bc1 block, 12 bits per texel, decoded as the normal (the rgb is read from the block, see PackedMaterial)
+	//block formats are always stored as 4x4 blocks row by row, the layout is ignored for them
+	enum class TextureFormat
+	{
+		rgba8, bc1, bc4, bc5, bc1bc4, bc5bc1
+	};
+
+	struct TextureLoadOptions
+	{
+		TextureLayout layout{ TextureLayout::linear };
+		TextureFormat format{ TextureFormat::rgba8 };
+		//keep the decoded result (mips, layout, compression) in the texture cache directory,
+		//later loads of the same file with the same options map it instead of decoding the PNG
+		bool useDiskCache{ true };
+	};
+
+	//Screen-space derivatives of the uv, used to select the mip level
+	struct UVDerivatives
+	{
+		Vector2 dUVdx{};
+		Vector2 dUVdy{};
+	};
 
 	class Texture
 	{
 	public:
-		~Texture();
+		~Texture() = default;
+
+		Texture(const Texture&) = delete;
+		Texture(Texture&&) noexcept = delete;
+		Texture& operator=(const Texture&) = delete;
+		Texture& operator=(Texture&&) noexcept = delete;
+
+		static std::unique_ptr<Texture> LoadFromFile(const std::string& path, const TextureLoadOptions& options = {});
+
+		//decoded texture as is (levels + texels/blocks), MapFromFile uses the file without copying it
+		bool SaveToFile(const std::string& path) const;
+		static std::unique_ptr<Texture> MapFromFile(const std::string& path);
+		static constexpr const char* cacheDirectory{ "TextureCache/" };
+
+		//without derivatives the mip filters sample level 0
+		ColorRGB Sample(const Vector2& uv, TextureFilter filter = TextureFilter::point, const UVDerivatives& derivatives = {}) const;
+		Vector3 SampleNormal(const Vector2& uv, TextureFilter filter = TextureFilter::point, const UVDerivatives& derivatives = {}) const;
+		Vector4 SampleRGBA(const Vector2& uv, TextureFilter filter, const UVDerivatives& derivatives) const;
+
+		//rgba in [0, 1], uv wraps (repeat)
+		Vector4 SamplePoint(const Vector2& uv, int level = 0) const;
+		Vector4 SampleBilinear(const Vector2& uv, int level = 0) const;
+		float ComputeLod(const UVDerivatives& derivatives) const;
+		static float ComputeLod(const UVDerivatives& derivatives, int width, int height, int levelCount);
+
+		//levels to sample for a filter, the result is lerp(level0, level1, factor)
+		struct MipSelection
+		{
+			int level0{};
+			int level1{};
+			float factor{};
+		};
+		MipSelection SelectMip(TextureFilter filter, const UVDerivatives& derivatives) const;
+		static MipSelection SelectMip(TextureFilter filter, const UVDerivatives& derivatives, int width, int height, int levelCount);
+
+		//the 4 RGBA8 texels under a bilinear footprint (00, 10, 01, 11) and the lerp factors
+		struct BilinearFootprint
+		{
+			uint32_t texels[4]{};
+			float fracX{};
+			float fracY{};
+		};
+		BilinearFootprint GatherBilinear(const Vector2& uv, int level) const;
+		static Vector4 FilterBilinear(const BilinearFootprint& footprint);
+
+		//coordinates of the texels under a bilinear footprint, wrapped into the level, and the lerp factors
+		//for textures whose texels have to be decoded before they can be filtered
+		struct BilinearTexels
+		{
+			int x0{}, y0{}, x1{}, y1{};
+			float fracX{};
+			float fracY{};
+		};
+		static BilinearTexels LocateBilinear(const Vector2& uv, int width, int height);
+
+		//decoded RGBA8 texel, x and y have to be inside the level
+		uint32_t FetchLevelTexel(int level, int x, int y) const;
+		//raw compressed block, nullptr for rgba8
+		const uint32_t* GetLevelBlock(int level, int blockX, int blockY) const;
+		//uint32 words per 4x4 block, 0 for rgba8
+		static int GetBlockWords(TextureFormat format);
+		//RGBA8 texel of a block, texelIndex = x + 4 * y inside the block
+		static uint32_t DecodeBlockTexel(TextureFormat format, const uint32_t* pBlock, int texelIndex);
+		int GetLevelWidth(int level) const { return m_Levels[level].width; }
+		int GetLevelHeight(int level) const { return m_Levels[level].height; }
+		//repeat addressing of a texel coordinate
+		static int Wrap(int coordinate, int size);
 
-		static std::unique_ptr<Texture> LoadFromFile(const std::string& path);
-		ColorRGB Sample(const Vector2& uv) const;
-		Vector3 SampleNormal(const Vector2& uv) const;
-		Texture(SDL_Surface* pSurface);
+		//builds an RGBA8 texture with a full mip chain, every texel of every level comes from generator(level, x, y)
+		static std::unique_ptr<Texture> Generate(int width, int height, const std::function<uint32_t(int, int, int)>& generator,
+			TextureLayout layout = TextureLayout::linear);
+		//every block of first followed by the block of second at the same place, copied as they are (nothing is encoded again)
+		//bc1 + bc4 => bc1bc4, bc5 + bc1 => bc5bc1, nullptr for other formats or when the sizes differ
+		static std::unique_ptr<Texture> InterleaveBlocks(const Texture& first, const Texture& second);
+
+		//takes ownership of the surface, converts it to RGBA8, builds the mip chain,
+		//compresses or reorders it according to the options and frees the surface
+		Texture(SDL_Surface* pSurface, const TextureLoadOptions& options = {});
+
+		int GetWidth() const { return m_Levels[0].width; }
+		int GetHeight() const { return m_Levels[0].height; }
+		int GetLevelCount() const { return static_cast<int>(m_Levels.size()); }
+		TextureLayout GetLayout() const { return m_Layout; }
+		TextureFormat GetFormat() const { return m_Format; }
+		size_t GetMemorySize() const { return m_WordCount * sizeof(uint32_t); }
+		bool IsMapped() const { return m_pMappedFile != nullptr; }
+		//the cache file this texture was mapped from or written to, empty when it is not in the cache
+		const std::string& GetCacheFile() const { return m_CacheFile; }
 
 	private:
+		Texture() = default;
+
+		struct MipLevel
+		{
+			int width{};
+			int height{};
+			size_t offset{};
+			int blocksPerRow{}; //tiled4x4 and block formats
+		};
+
+		//rgba8: texels with r in the lowest byte, no SDL_PixelFormat needed to decode a texel
+		//block formats: compressed blocks, see BlockCompression.h
+		//all mip levels back to back, level 0 first, offsets are in uint32 words
+		//m_Data is only filled while building, everything reads through m_pWords (m_Data or the mapped cache file)
+		std::vector<uint32_t> m_Data{};
+		std::unique_ptr<MappedFile> m_pMappedFile{ nullptr };
+		std::string m_CacheFile{};
+		const uint32_t* m_pWords{ nullptr };
+		size_t m_WordCount{};
+		std::vector<MipLevel> m_Levels{};
+		TextureLayout m_Layout{ TextureLayout::linear };
+		TextureFormat m_Format{ TextureFormat::rgba8 };
+
+		void GenerateMipChain();
+		void AddMipLevels();
+		void ApplyLayout(TextureLayout layout);
+		void Compress(TextureFormat format);
+		void FinishBuild();
+
+		static std::vector<uint8_t> ReadFile(const std::string& path);
+		static uint64_t HashFile(const std::vector<uint8_t>& fileData);
+		static std::string GetCachePath(const std::vector<uint8_t>& fileData, const TextureLoadOptions& options);
 
-		SDL_Surface* m_pSurface{ nullptr };
-		uint32_t* m_pSurfacePixels{ nullptr };
+		size_t TexelIndex(const MipLevel& mip, int x, int y) const;
+		uint32_t FetchTexel(const MipLevel& mip, int x, int y) const;
+		static size_t GetLevelSize(TextureLayout layout, int width, int height);
+		static uint32_t SpreadBits(uint32_t value);
+
+		static __m128 UnpackTexel(uint32_t texel);
 	};
-}
\ No newline at end of file
+
+	inline int Texture::Wrap(int coordinate, int size)
+	{
+		const int wrapped{ coordinate % size };
+		return wrapped < 0 ? wrapped + size : wrapped;
+	}
+
+	inline uint32_t Texture::SpreadBits(uint32_t value)
+	{
+		//0b...dcba => 0b...0d0c0b0a, 16 bit input
+		value = (value | (value << 8)) & 0x00ff00ff;
+		value = (value | (value << 4)) & 0x0f0f0f0f;
+		value = (value | (value << 2)) & 0x33333333;
+		value = (value | (value << 1)) & 0x55555555;
+		return value;
+	}
+
+	inline size_t Texture::TexelIndex(const MipLevel& mip, int x, int y) const
+	{
+		switch (m_Layout)
+		{
+		case TextureLayout::tiled4x4:
+			return mip.offset + (static_cast<size_t>((y >> 2) * mip.blocksPerRow + (x >> 2)) << 4) + ((y & 3) << 2) + (x & 3);
+
+		case TextureLayout::morton:
+			return mip.offset + (SpreadBits(static_cast<uint32_t>(x)) | (SpreadBits(static_cast<uint32_t>(y)) << 1));
+
+		case TextureLayout::linear:
+		default:
+			return mip.offset + x + static_cast<size_t>(y) * mip.width;
+		}
+	}
+
+	inline uint32_t Texture::FetchTexel(const MipLevel& mip, int x, int y) const
+	{
+		if (m_Format == TextureFormat::rgba8)
+			return m_pWords[TexelIndex(mip, x, y)];
+
+		//decode only the requested texel of its 4x4 block
+		const size_t blockIndex{ static_cast<size_t>((y >> 2) * mip.blocksPerRow + (x >> 2)) };
+		const int texelIndex{ ((y & 3) << 2) + (x & 3) };
+		return DecodeBlockTexel(m_Format, &m_pWords[mip.offset + blockIndex * GetBlockWords(m_Format)], texelIndex);
+	}
+
+	inline int Texture::GetBlockWords(TextureFormat format)
+	{
+		switch (format)
+		{
+		case TextureFormat::bc1: return BlockCompression::bc1BlockWords;
+		case TextureFormat::bc4: return BlockCompression::bc4BlockWords;
+		case TextureFormat::bc5: return BlockCompression::bc5BlockWords;
+		case TextureFormat::bc1bc4: return BlockCompression::bc1BlockWords + BlockCompression::bc4BlockWords;
+		case TextureFormat::bc5bc1: return BlockCompression::bc5BlockWords + BlockCompression::bc1BlockWords;
+		case TextureFormat::rgba8:
+		default: return 0;
+		}
+	}
+
+	inline uint32_t Texture::DecodeBlockTexel(TextureFormat format, const uint32_t* pBlock, int texelIndex)
+	{
+		switch (format)
+		{
+		case TextureFormat::bc1:
+			return BlockCompression::DecodeBC1Texel(pBlock, texelIndex);
+		case TextureFormat::bc4:
+			return BlockCompression::DecodeBC4Texel(pBlock, texelIndex);
+		case TextureFormat::bc1bc4:
+			return (BlockCompression::DecodeBC1Texel(pBlock, texelIndex) & 0x00ffffff)
+				| (BlockCompression::DecodeBC4Value(pBlock + BlockCompression::bc1BlockWords, texelIndex) << 24);
+		case TextureFormat::bc5:
+		case TextureFormat::bc5bc1:
+		default:
+			return BlockCompression::DecodeBC5Texel(pBlock, texelIndex);
+		}
+	}
+
+	inline __m128 Texture::UnpackTexel(uint32_t texel)
+	{
+		//RGBA8 => 4 floats in [0, 255]
+		const __m128i zero{ _mm_setzero_si128() };
+		const __m128i bytes{ _mm_cvtsi32_si128(static_cast<int>(texel)) };
+		return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+	}
+
+	inline Vector4 Texture::SamplePoint(const Vector2& uv, int level) const
+	{
+		const MipLevel& mip{ m_Levels[level] };
+		const int x{ Wrap(static_cast<int>(std::floor(uv.x * mip.width)), mip.width) };
+		const int y{ Wrap(static_cast<int>(std::floor(uv.y * mip.height)), mip.height) };
+
+		const uint32_t texel{ FetchTexel(mip, x, y) };
+
+		const float colorRemap{ 1 / 255.f };
+		return {
+			(texel & 0xff) * colorRemap,
+			((texel >> 8) & 0xff) * colorRemap,
+			((texel >> 16) & 0xff) * colorRemap,
+			(texel >> 24) * colorRemap };
+	}
+
+	inline Texture::BilinearTexels Texture::LocateBilinear(const Vector2& uv, int width, int height)
+	{
+		//texel centers are at +0.5
+		const float x{ uv.x * width - 0.5f };
+		const float y{ uv.y * height - 0.5f };
+		const float floorX{ std::floor(x) };
+		const float floorY{ std::floor(y) };
+
+		const int x0{ Wrap(static_cast<int>(floorX), width) };
+		const int y0{ Wrap(static_cast<int>(floorY), height) };
+		return BilinearTexels{ x0, y0, x0 + 1 == width ? 0 : x0 + 1, y0 + 1 == height ? 0 : y0 + 1, x - floorX, y - floorY };
+	}
+
+	inline Texture::BilinearFootprint Texture::GatherBilinear(const Vector2& uv, int level) const
+	{
+		const MipLevel& mip{ m_Levels[level] };
+		const BilinearTexels texels{ LocateBilinear(uv, mip.width, mip.height) };
+
+		return BilinearFootprint
+		{
+			{ FetchTexel(mip, texels.x0, texels.y0), FetchTexel(mip, texels.x1, texels.y0), FetchTexel(mip, texels.x0, texels.y1), FetchTexel(mip, texels.x1, texels.y1) },
+			texels.fracX,
+			texels.fracY
+		};
+	}
+
+	inline uint32_t Texture::FetchLevelTexel(int level, int x, int y) const
+	{
+		return FetchTexel(m_Levels[level], x, y);
+	}
+
+	inline const uint32_t* Texture::GetLevelBlock(int level, int blockX, int blockY) const
+	{
+		if (m_Format == TextureFormat::rgba8) return nullptr;
+
+		const MipLevel& mip{ m_Levels[level] };
+		return &m_pWords[mip.offset + (static_cast<size_t>(blockY) * mip.blocksPerRow + blockX) * GetBlockWords(m_Format)];
+	}
+
+	inline Vector4 Texture::FilterBilinear(const BilinearFootprint& footprint)
+	{
+		const __m128 texel00{ UnpackTexel(footprint.texels[0]) };
+		const __m128 texel10{ UnpackTexel(footprint.texels[1]) };
+		const __m128 texel01{ UnpackTexel(footprint.texels[2]) };
+		const __m128 texel11{ UnpackTexel(footprint.texels[3]) };
+
+		//lerp horizontally, then vertically, all 4 channels at once
+		const __m128 fracX{ _mm_set1_ps(footprint.fracX) };
+		const __m128 fracY{ _mm_set1_ps(footprint.fracY) };
+		const __m128 top{ _mm_add_ps(texel00, _mm_mul_ps(_mm_sub_ps(texel10, texel00), fracX)) };
+		const __m128 bottom{ _mm_add_ps(texel01, _mm_mul_ps(_mm_sub_ps(texel11, texel01), fracX)) };
+		const __m128 result{ _mm_mul_ps(_mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), fracY)), _mm_set1_ps(1 / 255.f)) };
+
+		alignas(16) float rgba[4];
+		_mm_store_ps(rgba, result);
+		return { rgba[0], rgba[1], rgba[2], rgba[3] };
+	}
+
+	inline Vector4 Texture::SampleBilinear(const Vector2& uv, int level) const
+	{
+		return FilterBilinear(GatherBilinear(uv, level));
+	}
+
+	inline float Texture::ComputeLod(const UVDerivatives& derivatives, int width, int height, int levelCount)
+	{
+		//footprint of the pixel in level 0 texels, the longest axis decides the level
+		const Vector2 dx{ derivatives.dUVdx.x * width, derivatives.dUVdx.y * height };
+		const Vector2 dy{ derivatives.dUVdy.x * width, derivatives.dUVdy.y * height };
+		const float maxSqrFootprint{ std::max(dx.SqrMagnitude(), dy.SqrMagnitude()) };
+
+		//magnified (or degenerate triangle => NaN), level 0
+		if (!(maxSqrFootprint > 1.f)) return 0.f;
+
+		//log2(sqrt(x)) == 0.5 * log2(x)
+		const float lod{ 0.5f * std::log2(maxSqrFootprint) };
+		return Clamp(lod, 0.f, static_cast<float>(levelCount - 1));
+	}
+
+	inline float Texture::ComputeLod(const UVDerivatives& derivatives) const
+	{
+		return ComputeLod(derivatives, GetWidth(), GetHeight(), GetLevelCount());
+	}
+
+	inline Texture::MipSelection Texture::SelectMip(TextureFilter filter, const UVDerivatives& derivatives, int width, int height, int levelCount)
+	{
+		switch (filter)
+		{
+		case TextureFilter::nearestMip:
+		{
+			const int level{ static_cast<int>(ComputeLod(derivatives, width, height, levelCount) + 0.5f) };
+			return { level, level, 0.f };
+		}
+
+		case TextureFilter::trilinear:
+		{
+			const float lod{ ComputeLod(derivatives, width, height, levelCount) };
+			const int level0{ static_cast<int>(lod) };
+			return { level0, std::min(level0 + 1, levelCount - 1), lod - level0 };
+		}
+
+		case TextureFilter::point:
+		case TextureFilter::bilinear:
+		default:
+			return {};
+		}
+	}
+
+	inline Texture::MipSelection Texture::SelectMip(TextureFilter filter, const UVDerivatives& derivatives) const
+	{
+		return SelectMip(filter, derivatives, GetWidth(), GetHeight(), GetLevelCount());
+	}
+
+	inline Vector4 Texture::SampleRGBA(const Vector2& uv, TextureFilter filter, const UVDerivatives& derivatives) const
+	{
+		if (filter == TextureFilter::point)
+			return SamplePoint(uv);
+
+		const MipSelection mip{ SelectMip(filter, derivatives) };
+
+		const Vector4 sample0{ SampleBilinear(uv, mip.level0) };
+		if (mip.level0 == mip.level1 || mip.factor == 0.f) return sample0;
+
+		const Vector4 sample1{ SampleBilinear(uv, mip.level1) };
+		return sample0 + (sample1 - sample0) * mip.factor;
+	}
+
+	inline ColorRGB Texture::Sample(const Vector2& uv, TextureFilter filter, const UVDerivatives& derivatives) const
+	{
+		const Vector4 rgba{ SampleRGBA(uv, filter, derivatives) };
+		return { rgba.x, rgba.y, rgba.z };
+	}
+
+	inline Vector3 Texture::SampleNormal(const Vector2& uv, TextureFilter filter, const UVDerivatives& derivatives) const
+	{
+		const Vector4 rgba{ SampleRGBA(uv, filter, derivatives) };
+		return { rgba.x, rgba.y, rgba.z };
+	}
+}
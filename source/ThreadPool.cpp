@@ -0,0 +1,116 @@
+#include "ThreadPool.h"
+
+namespace dae
+{
+	ThreadPool::ThreadPool(uint32_t threadCount)
+	{
+		const uint32_t workerCount{ threadCount > 1 ? threadCount - 1 : 0 };
+
+		m_Workers.reserve(workerCount);
+		for (uint32_t i{}; i < workerCount; ++i)
+		{
+			m_Workers.emplace_back([this] { WorkerLoop(); });
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_IsStopping = true;
+		}
+		m_WakeCondition.notify_all();
+
+		for (std::thread& worker : m_Workers)
+		{
+			worker.join();
+		}
+	}
+
+	void ThreadPool::WorkerLoop()
+	{
+		uint64_t seenGeneration{};
+
+		std::unique_lock lock{ m_Mutex };
+		while (true)
+		{
+			m_WakeCondition.wait(lock, [&] { return m_IsStopping || seenGeneration != m_JobGeneration || !m_Tasks.empty(); });
+			if (m_IsStopping) return;
+
+			if (seenGeneration != m_JobGeneration)
+			{
+				seenGeneration = m_JobGeneration;
+
+				//the job can already be finished and cleared by the time this worker wakes up
+				ParallelJob* pJob{ m_pJob };
+				if (!pJob) continue;
+
+				++m_WorkersInJob;
+				lock.unlock();
+
+				RunChunks(*pJob);
+
+				lock.lock();
+				if (--m_WorkersInJob == 0)
+				{
+					m_DoneCondition.notify_all();
+				}
+				continue;
+			}
+
+			std::function<void()> task{ std::move(m_Tasks.front()) };
+			m_Tasks.pop_front();
+			lock.unlock();
+
+			task();
+
+			lock.lock();
+		}
+	}
+
+	void ThreadPool::Run(ParallelJob* pJob)
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_pJob = pJob;
+			++m_JobGeneration;
+		}
+		m_WakeCondition.notify_all();
+
+		//the calling thread works too
+		RunChunks(*pJob);
+
+		//every chunk is claimed now, wait for the workers that are still busy with theirs
+		std::unique_lock lock{ m_Mutex };
+		m_DoneCondition.wait(lock, [this] { return m_WorkersInJob == 0; });
+		m_pJob = nullptr;
+	}
+
+	void ThreadPool::PushTask(std::function<void()> task)
+	{
+		//no workers, run it right away so the future is ready
+		if (m_Workers.empty())
+		{
+			task();
+			return;
+		}
+
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_Tasks.push_back(std::move(task));
+		}
+		m_WakeCondition.notify_one();
+	}
+
+	void ThreadPool::RunChunks(ParallelJob& job)
+	{
+		while (true)
+		{
+			const size_t begin{ job.nextBegin.fetch_add(job.grainSize) };
+			if (begin >= job.count) return;
+
+			const size_t end{ begin + job.grainSize < job.count ? begin + job.grainSize : job.count };
+			job.pInvoke(job.pFunc, begin, end);
+		}
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	//Persistent worker threads, used to split per-frame work (vertex stage, ...) across all cores
+	//and to run long background tasks (asset loading, ...) next to it
+	class ThreadPool final
+	{
+	public:
+		//threadCount includes the calling thread, which always helps with ParallelFor
+		explicit ThreadPool(uint32_t threadCount = std::thread::hardware_concurrency());
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		//Splits [0, count) into chunks of grainSize and calls func(begin, end) for every chunk
+		//chunks are disjoint, so func may write to its own range of a pre-sized buffer without locking
+		//blocks until every chunk is done, does not allocate
+		template<typename Func>
+		void ParallelFor(size_t count, size_t grainSize, const Func& func);
+
+		//Queues func() to run on a worker, the future holds its result (or exception)
+		//ParallelFor jobs take priority over queued tasks, a worker busy with a task just skips the job
+		//allocates, not meant for per-frame work
+		template<typename Func>
+		std::future<std::invoke_result_t<Func>> Enqueue(Func&& func);
+
+		uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()) + 1; }
+
+	private:
+		struct ParallelJob
+		{
+			void (*pInvoke)(const void* pFunc, size_t begin, size_t end);
+			const void* pFunc;
+			size_t count;
+			size_t grainSize;
+			std::atomic<size_t> nextBegin;
+		};
+
+		std::vector<std::thread> m_Workers{};
+		std::mutex m_Mutex{};
+		std::condition_variable m_WakeCondition{};
+		std::condition_variable m_DoneCondition{};
+
+		//std::function needs a copyable callable, the packaged_task is kept alive by a shared_ptr
+		std::deque<std::function<void()>> m_Tasks{};
+
+		ParallelJob* m_pJob{ nullptr };
+		uint64_t m_JobGeneration{};
+		uint32_t m_WorkersInJob{};
+		bool m_IsStopping{ false };
+
+		void WorkerLoop();
+		void Run(ParallelJob* pJob);
+		void PushTask(std::function<void()> task);
+		static void RunChunks(ParallelJob& job);
+	};
+
+	template<typename Func>
+	void ThreadPool::ParallelFor(size_t count, size_t grainSize, const Func& func)
+	{
+		if (count == 0) return;
+		if (grainSize == 0) grainSize = 1;
+
+		ParallelJob job
+		{
+			[](const void* pFunc, size_t begin, size_t end) { (*static_cast<const Func*>(pFunc))(begin, end); },
+			&func,
+			count,
+			grainSize,
+			{ 0 }
+		};
+
+		//not worth waking the workers for a single chunk
+		if (m_Workers.empty() || count <= grainSize)
+		{
+			RunChunks(job);
+			return;
+		}
+
+		Run(&job);
+	}
+
+	template<typename Func>
+	std::future<std::invoke_result_t<Func>> ThreadPool::Enqueue(Func&& func)
+	{
+		using Result = std::invoke_result_t<Func>;
+
+		const auto pTask{ std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func)) };
+		std::future<Result> future{ pTask->get_future() };
+
+		PushTask([pTask] { (*pTask)(); });
+		return future;
+	}
+}
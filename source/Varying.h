@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include "Math.h"
+
+//MSVC only applies the empty base optimization to the first empty base without this
+#ifdef _MSC_VER
+#define DAE_EMPTY_BASES __declspec(empty_bases)
+#else
+#define DAE_EMPTY_BASES
+#endif
+
+namespace dae
+{
+	//Bit mask of the attributes a shader passes from the vertex to the pixel stage
+	//position (x, y, depth, view depth) is always there
+	namespace VaryingAttribute
+	{
+		constexpr uint32_t color{ 1 << 0 };
+		constexpr uint32_t uv{ 1 << 1 };
+		constexpr uint32_t normal{ 1 << 2 };
+		constexpr uint32_t tangent{ 1 << 3 };
+		constexpr uint32_t viewDirection{ 1 << 4 };
+		//light and view direction in the tangent frame of the vertex, for tangent-space lighting
+		constexpr uint32_t tangentLightDirection{ 1 << 5 };
+		constexpr uint32_t tangentViewDirection{ 1 << 6 };
+		//for lights that depend on where the pixel is (point, spot)
+		constexpr uint32_t worldPosition{ 1 << 7 };
+		//clip-space position in the previous frame (before the perspective divide), for temporal reprojection
+		constexpr uint32_t previousPosition{ 1 << 8 };
+		constexpr uint32_t worldSpace{ color | uv | normal | tangent | viewDirection };
+		constexpr uint32_t all{ worldSpace | tangentLightDirection | tangentViewDirection | worldPosition | previousPosition };
+	}
+
+	namespace VaryingDetail
+	{
+		//one base per attribute, empty when the attribute is not declared
+		template<bool> struct ColorSlot {};
+		template<> struct ColorSlot<true> { ColorRGB color{ colors::White }; };
+		template<bool> struct UVSlot {};
+		template<> struct UVSlot<true> { Vector2 uv{}; };
+		template<bool> struct NormalSlot {};
+		template<> struct NormalSlot<true> { Vector3 normal{}; };
+		template<bool> struct TangentSlot {};
+		template<> struct TangentSlot<true> { Vector3 tangent{}; };
+		template<bool> struct ViewDirectionSlot {};
+		template<> struct ViewDirectionSlot<true> { Vector3 viewDirection{}; };
+		template<bool> struct TangentLightDirectionSlot {};
+		template<> struct TangentLightDirectionSlot<true> { Vector3 tangentLightDirection{}; };
+		template<bool> struct TangentViewDirectionSlot {};
+		template<> struct TangentViewDirectionSlot<true> { Vector3 tangentViewDirection{}; };
+		template<bool> struct WorldPositionSlot {};
+		template<> struct WorldPositionSlot<true> { Vector3 worldPosition{}; };
+		template<bool> struct PreviousPositionSlot {};
+		template<> struct PreviousPositionSlot<true> { Vector4 previousPosition{}; };
+	}
+
+	//Vertex shader output / pixel shader input with only the declared attributes,
+	//so the vertex buffers and the interpolation in the raster loop only cover what the shader reads
+	template<uint32_t attributes>
+	struct DAE_EMPTY_BASES Varying :
+		VaryingDetail::ColorSlot<(attributes & VaryingAttribute::color) != 0>,
+		VaryingDetail::UVSlot<(attributes & VaryingAttribute::uv) != 0>,
+		VaryingDetail::NormalSlot<(attributes & VaryingAttribute::normal) != 0>,
+		VaryingDetail::TangentSlot<(attributes & VaryingAttribute::tangent) != 0>,
+		VaryingDetail::ViewDirectionSlot<(attributes & VaryingAttribute::viewDirection) != 0>,
+		VaryingDetail::TangentLightDirectionSlot<(attributes & VaryingAttribute::tangentLightDirection) != 0>,
+		VaryingDetail::TangentViewDirectionSlot<(attributes & VaryingAttribute::tangentViewDirection) != 0>,
+		VaryingDetail::WorldPositionSlot<(attributes & VaryingAttribute::worldPosition) != 0>,
+		VaryingDetail::PreviousPositionSlot<(attributes & VaryingAttribute::previousPosition) != 0>
+	{
+		static constexpr uint32_t attributeMask{ attributes };
+		static constexpr bool Has(uint32_t attribute) { return (attributes & attribute) == attribute; }
+
+		Vector4 position{};
+
+		//perspective-correct blend of every declared attribute but position, the weights already include 1/w
+		static Varying Interpolate(const Varying& v0, const Varying& v1, const Varying& v2, float weight0, float weight1, float weight2)
+		{
+			Varying result{};
+			if constexpr (Has(VaryingAttribute::color)) result.color = v0.color * weight0 + v1.color * weight1 + v2.color * weight2;
+			if constexpr (Has(VaryingAttribute::uv)) result.uv = v0.uv * weight0 + v1.uv * weight1 + v2.uv * weight2;
+			if constexpr (Has(VaryingAttribute::normal)) result.normal = v0.normal * weight0 + v1.normal * weight1 + v2.normal * weight2;
+			if constexpr (Has(VaryingAttribute::tangent)) result.tangent = v0.tangent * weight0 + v1.tangent * weight1 + v2.tangent * weight2;
+			if constexpr (Has(VaryingAttribute::viewDirection)) result.viewDirection = v0.viewDirection * weight0 + v1.viewDirection * weight1 + v2.viewDirection * weight2;
+			if constexpr (Has(VaryingAttribute::tangentLightDirection)) result.tangentLightDirection = v0.tangentLightDirection * weight0 + v1.tangentLightDirection * weight1 + v2.tangentLightDirection * weight2;
+			if constexpr (Has(VaryingAttribute::tangentViewDirection)) result.tangentViewDirection = v0.tangentViewDirection * weight0 + v1.tangentViewDirection * weight1 + v2.tangentViewDirection * weight2;
+			if constexpr (Has(VaryingAttribute::worldPosition)) result.worldPosition = v0.worldPosition * weight0 + v1.worldPosition * weight1 + v2.worldPosition * weight2;
+			if constexpr (Has(VaryingAttribute::previousPosition)) result.previousPosition = v0.previousPosition * weight0 + v1.previousPosition * weight1 + v2.previousPosition * weight2;
+			return result;
+		}
+	};
+}
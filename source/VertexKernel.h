@@ -0,0 +1,233 @@
+#pragma once
+#include <cassert>
+#include <immintrin.h>
+#include "Math.h"
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Matrices hoisted out of the vertex loop, computed once per mesh per frame
+	struct VertexKernelConstants
+	{
+		Matrix worldViewProjection{};
+		Matrix world{};
+		Vector3 cameraOrigin{};
+		//world-space direction the light travels in, only read for the tangent-space attributes
+		Vector3 lightDirection{};
+		//last frame's world * viewProjection, only read for previousPosition
+		Matrix previousWorldViewProjection{};
+	};
+
+	//Transforms the vertices [begin, end) of the SoA stream into pOut[begin, end)
+	//processes 4 vertices per iteration with SSE, begin has to be a multiple of 4
+	//only the attributes the varying declares are computed and written
+	template<uint32_t attributes>
+	void TransformVerticesSIMD(const VertexStreamSoA& stream, size_t begin, size_t end,
+		const VertexKernelConstants& constants, Varying<attributes>* pOut);
+
+	//Vertex shader policy for DrawMesh (see Pipeline.h) around TransformVerticesSIMD
+	template<uint32_t attributes>
+	struct VehicleVertexShader
+	{
+		using Varying = dae::Varying<attributes>;
+
+		VertexKernelConstants constants{};
+
+		void ShadeVertices(const VertexStreamSoA& stream, size_t begin, size_t end, Varying* pOut) const
+		{
+			TransformVerticesSIMD(stream, begin, end, constants, pOut);
+		}
+	};
+
+	namespace VertexKernelDetail
+	{
+		struct Matrix4x4SSE
+		{
+			//m[row][column] broadcast into all 4 lanes
+			__m128 m[4][4];
+
+			explicit Matrix4x4SSE(const Matrix& matrix)
+			{
+				for (int r{}; r < 4; ++r)
+				{
+					const Vector4 row{ matrix[r] };
+					m[r][0] = _mm_set1_ps(row.x);
+					m[r][1] = _mm_set1_ps(row.y);
+					m[r][2] = _mm_set1_ps(row.z);
+					m[r][3] = _mm_set1_ps(row.w);
+				}
+			}
+		};
+
+		//row vector * matrix for a single output column, w = 0 (vector) or w = 1 (point)
+		inline __m128 TransformColumn(const Matrix4x4SSE& mat, int column, __m128 x, __m128 y, __m128 z)
+		{
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, mat.m[0][column]), _mm_mul_ps(y, mat.m[1][column])), _mm_mul_ps(z, mat.m[2][column]));
+		}
+
+		inline void Normalize(__m128& x, __m128& y, __m128& z)
+		{
+			const __m128 magnitude{ _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z))) };
+			x = _mm_div_ps(x, magnitude);
+			y = _mm_div_ps(y, magnitude);
+			z = _mm_div_ps(z, magnitude);
+		}
+
+		//world-space direction, normalized
+		inline void TransformDirection(const Matrix4x4SSE& world, const float* pX, const float* pY, const float* pZ, __m128& x, __m128& y, __m128& z)
+		{
+			const __m128 dx{ _mm_loadu_ps(pX) };
+			const __m128 dy{ _mm_loadu_ps(pY) };
+			const __m128 dz{ _mm_loadu_ps(pZ) };
+			x = TransformColumn(world, 0, dx, dy, dz);
+			y = TransformColumn(world, 1, dx, dy, dz);
+			z = TransformColumn(world, 2, dx, dy, dz);
+			Normalize(x, y, z);
+		}
+
+		inline __m128 Dot(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+		{
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+		}
+
+		inline void Store(float (&out)[3][4], __m128 x, __m128 y, __m128 z)
+		{
+			_mm_store_ps(out[0], x);
+			_mm_store_ps(out[1], y);
+			_mm_store_ps(out[2], z);
+		}
+	}
+
+	template<uint32_t attributes>
+	void TransformVerticesSIMD(const VertexStreamSoA& stream, size_t begin, size_t end,
+		const VertexKernelConstants& constants, Varying<attributes>* pOut)
+	{
+		using namespace VertexKernelDetail;
+		using Out = Varying<attributes>;
+
+		assert((begin & 3) == 0 && "TransformVerticesSIMD: begin has to be a multiple of 4");
+		assert(end <= stream.count);
+
+		const Matrix4x4SSE wvp{ constants.worldViewProjection };
+		const Matrix4x4SSE world{ constants.world };
+		const Matrix4x4SSE previousWvp{ constants.previousWorldViewProjection };
+		const __m128 cameraX{ _mm_set1_ps(constants.cameraOrigin.x) };
+		const __m128 cameraY{ _mm_set1_ps(constants.cameraOrigin.y) };
+		const __m128 cameraZ{ _mm_set1_ps(constants.cameraOrigin.z) };
+
+		alignas(16) float position[4][4];
+		alignas(16) float normal[3][4];
+		alignas(16) float tangent[3][4];
+		alignas(16) float viewDirection[3][4];
+		alignas(16) float tangentLightDirection[3][4];
+		alignas(16) float tangentViewDirection[3][4];
+		alignas(16) float worldPosition[3][4];
+		alignas(16) float previousPosition[4][4];
+
+		for (size_t i{ begin }; i < end; i += 4)
+		{
+			const __m128 px{ _mm_loadu_ps(&stream.positionX[i]) };
+			const __m128 py{ _mm_loadu_ps(&stream.positionY[i]) };
+			const __m128 pz{ _mm_loadu_ps(&stream.positionZ[i]) };
+
+			//position => clip space + perspective divide (w is kept)
+			const __m128 clipW{ _mm_add_ps(TransformColumn(wvp, 3, px, py, pz), wvp.m[3][3]) };
+			const __m128 invW{ _mm_div_ps(_mm_set1_ps(1.f), clipW) };
+			_mm_store_ps(position[0], _mm_mul_ps(_mm_add_ps(TransformColumn(wvp, 0, px, py, pz), wvp.m[3][0]), invW));
+			_mm_store_ps(position[1], _mm_mul_ps(_mm_add_ps(TransformColumn(wvp, 1, px, py, pz), wvp.m[3][1]), invW));
+			_mm_store_ps(position[2], _mm_mul_ps(_mm_add_ps(TransformColumn(wvp, 2, px, py, pz), wvp.m[3][2]), invW));
+			_mm_store_ps(position[3], clipW);
+
+			if constexpr (Out::Has(VaryingAttribute::worldPosition))
+			{
+				Store(worldPosition,
+					_mm_add_ps(TransformColumn(world, 0, px, py, pz), world.m[3][0]),
+					_mm_add_ps(TransformColumn(world, 1, px, py, pz), world.m[3][1]),
+					_mm_add_ps(TransformColumn(world, 2, px, py, pz), world.m[3][2]));
+			}
+
+			//no divide, the pixel stage interpolates it like any other attribute and divides per pixel
+			if constexpr (Out::Has(VaryingAttribute::previousPosition))
+			{
+				for (int column{}; column < 4; ++column)
+				{
+					_mm_store_ps(previousPosition[column], _mm_add_ps(TransformColumn(previousWvp, column, px, py, pz), previousWvp.m[3][column]));
+				}
+			}
+
+			//the tangent-space directions need the whole world-space frame
+			constexpr bool needsTangentFrame{ Out::Has(VaryingAttribute::tangentLightDirection) || Out::Has(VaryingAttribute::tangentViewDirection) };
+			__m128 nx{}, ny{}, nz{}, tx{}, ty{}, tz{}, vx{}, vy{}, vz{};
+
+			if constexpr (Out::Has(VaryingAttribute::normal) || needsTangentFrame)
+			{
+				TransformDirection(world, &stream.normalX[i], &stream.normalY[i], &stream.normalZ[i], nx, ny, nz);
+				if constexpr (Out::Has(VaryingAttribute::normal)) Store(normal, nx, ny, nz);
+			}
+
+			if constexpr (Out::Has(VaryingAttribute::tangent) || needsTangentFrame)
+			{
+				TransformDirection(world, &stream.tangentX[i], &stream.tangentY[i], &stream.tangentZ[i], tx, ty, tz);
+				if constexpr (Out::Has(VaryingAttribute::tangent)) Store(tangent, tx, ty, tz);
+			}
+
+			//viewDirection, same as the scalar version: TransformVector(position) - camera origin
+			if constexpr (Out::Has(VaryingAttribute::viewDirection) || Out::Has(VaryingAttribute::tangentViewDirection))
+			{
+				vx = _mm_sub_ps(TransformColumn(world, 0, px, py, pz), cameraX);
+				vy = _mm_sub_ps(TransformColumn(world, 1, px, py, pz), cameraY);
+				vz = _mm_sub_ps(TransformColumn(world, 2, px, py, pz), cameraZ);
+				Normalize(vx, vy, vz);
+				if constexpr (Out::Has(VaryingAttribute::viewDirection)) Store(viewDirection, vx, vy, vz);
+			}
+
+			//project onto the same tangent, binormal, normal frame the per-pixel normal mapping builds
+			if constexpr (needsTangentFrame)
+			{
+				__m128 bx{ _mm_sub_ps(_mm_mul_ps(ny, tz), _mm_mul_ps(nz, ty)) };
+				__m128 by{ _mm_sub_ps(_mm_mul_ps(nz, tx), _mm_mul_ps(nx, tz)) };
+				__m128 bz{ _mm_sub_ps(_mm_mul_ps(nx, ty), _mm_mul_ps(ny, tx)) };
+				Normalize(bx, by, bz);
+
+				if constexpr (Out::Has(VaryingAttribute::tangentLightDirection))
+				{
+					const __m128 lx{ _mm_set1_ps(constants.lightDirection.x) };
+					const __m128 ly{ _mm_set1_ps(constants.lightDirection.y) };
+					const __m128 lz{ _mm_set1_ps(constants.lightDirection.z) };
+					Store(tangentLightDirection, Dot(lx, ly, lz, tx, ty, tz), Dot(lx, ly, lz, bx, by, bz), Dot(lx, ly, lz, nx, ny, nz));
+				}
+
+				if constexpr (Out::Has(VaryingAttribute::tangentViewDirection))
+				{
+					Store(tangentViewDirection, Dot(vx, vy, vz, tx, ty, tz), Dot(vx, vy, vz, bx, by, bz), Dot(vx, vy, vz, nx, ny, nz));
+				}
+			}
+
+			//SoA => AoS, only the lanes that are real vertices
+			const size_t laneCount{ end - i < 4 ? end - i : 4 };
+			for (size_t lane{}; lane < laneCount; ++lane)
+			{
+				Out& vertexOut{ pOut[i + lane] };
+				vertexOut.position = { position[0][lane], position[1][lane], position[2][lane], position[3][lane] };
+				if constexpr (Out::Has(VaryingAttribute::color))
+					vertexOut.color = { stream.colorR[i + lane], stream.colorG[i + lane], stream.colorB[i + lane] };
+				if constexpr (Out::Has(VaryingAttribute::uv))
+					vertexOut.uv = { stream.u[i + lane], stream.v[i + lane] };
+				if constexpr (Out::Has(VaryingAttribute::normal))
+					vertexOut.normal = { normal[0][lane], normal[1][lane], normal[2][lane] };
+				if constexpr (Out::Has(VaryingAttribute::tangent))
+					vertexOut.tangent = { tangent[0][lane], tangent[1][lane], tangent[2][lane] };
+				if constexpr (Out::Has(VaryingAttribute::viewDirection))
+					vertexOut.viewDirection = { viewDirection[0][lane], viewDirection[1][lane], viewDirection[2][lane] };
+				if constexpr (Out::Has(VaryingAttribute::tangentLightDirection))
+					vertexOut.tangentLightDirection = { tangentLightDirection[0][lane], tangentLightDirection[1][lane], tangentLightDirection[2][lane] };
+				if constexpr (Out::Has(VaryingAttribute::tangentViewDirection))
+					vertexOut.tangentViewDirection = { tangentViewDirection[0][lane], tangentViewDirection[1][lane], tangentViewDirection[2][lane] };
+				if constexpr (Out::Has(VaryingAttribute::worldPosition))
+					vertexOut.worldPosition = { worldPosition[0][lane], worldPosition[1][lane], worldPosition[2][lane] };
+				if constexpr (Out::Has(VaryingAttribute::previousPosition))
+					vertexOut.previousPosition = { previousPosition[0][lane], previousPosition[1][lane], previousPosition[2][lane], previousPosition[3][lane] };
+			}
+		}
+	}
+}
@@ -0,0 +1,350 @@
+#include "VirtualTexture.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+
+namespace dae
+{
+	std::vector<VirtualTexture::Level> VirtualTexture::BuildLevels(int width, int height, uint32_t& pageCount)
+	{
+		//same mip chain as Texture, pages are numbered level by level, so a higher page index is a coarser level
+		std::vector<Level> levels{};
+		pageCount = 0;
+		while (true)
+		{
+			const int pagesX{ (width + pageSize - 1) / pageSize };
+			const int pagesY{ (height + pageSize - 1) / pageSize };
+			levels.push_back({ width, height, pagesX, pagesY, pageCount });
+			pageCount += static_cast<uint32_t>(pagesX * pagesY);
+
+			if (width == 1 && height == 1) break;
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+		}
+		return levels;
+	}
+
+	size_t VirtualTexture::GetPageWords(TextureFormat format)
+	{
+		constexpr size_t blocksPerPage{ (pageSize / 4) * (pageSize / 4) };
+		if (format == TextureFormat::rgba8) return static_cast<size_t>(pageSize) * pageSize;
+		return blocksPerPage * Texture::GetBlockWords(format);
+	}
+
+	std::unique_ptr<VirtualTexture> VirtualTexture::Create(const Texture& source, const std::string& pageFilePath, size_t memoryBudget)
+	{
+		const TextureFormat format{ source.GetFormat() };
+		uint32_t pageCount{};
+		const std::vector<Level> levels{ BuildLevels(source.GetWidth(), source.GetHeight(), pageCount) };
+
+		//written next to the destination first, a crash halfway never leaves a truncated page file behind
+		const std::string temporaryPath{ pageFilePath + ".tmp" };
+		std::ofstream file{ temporaryPath, std::ios::binary | std::ios::trunc };
+		if (!file)
+		{
+			std::cout << "could not create page file " << pageFilePath << "\n";
+			return nullptr;
+		}
+
+		const uint32_t header[6]{ fileMagic, static_cast<uint32_t>(format), static_cast<uint32_t>(source.GetWidth()),
+			static_cast<uint32_t>(source.GetHeight()), static_cast<uint32_t>(levels.size()), static_cast<uint32_t>(pageSize) };
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+		//pages keep the format of the source: raw blocks are copied, RGBA8 texels are copied row by row
+		//the edge pages of a level are padded with its last row/column
+		const int blockWords{ Texture::GetBlockWords(format) };
+		std::vector<uint32_t> page(GetPageWords(format));
+		for (size_t levelIndex{}; levelIndex < levels.size(); ++levelIndex)
+		{
+			const Level& level{ levels[levelIndex] };
+			const int level32{ static_cast<int>(levelIndex) };
+
+			for (int pageY{}; pageY < level.pagesY; ++pageY)
+			{
+				for (int pageX{}; pageX < level.pagesX; ++pageX)
+				{
+					if (format == TextureFormat::rgba8)
+					{
+						for (int y{}; y < pageSize; ++y)
+						{
+							for (int x{}; x < pageSize; ++x)
+							{
+								const int sourceX{ std::min(pageX * pageSize + x, level.width - 1) };
+								const int sourceY{ std::min(pageY * pageSize + y, level.height - 1) };
+								page[x + static_cast<size_t>(y) * pageSize] = source.FetchLevelTexel(level32, sourceX, sourceY);
+							}
+						}
+					}
+					else
+					{
+						constexpr int blocksPerSide{ pageSize / 4 };
+						const int levelBlocksX{ (level.width + 3) / 4 };
+						const int levelBlocksY{ (level.height + 3) / 4 };
+						for (int blockY{}; blockY < blocksPerSide; ++blockY)
+						{
+							for (int blockX{}; blockX < blocksPerSide; ++blockX)
+							{
+								const int sourceBlockX{ std::min(pageX * blocksPerSide + blockX, levelBlocksX - 1) };
+								const int sourceBlockY{ std::min(pageY * blocksPerSide + blockY, levelBlocksY - 1) };
+								const uint32_t* pBlock{ source.GetLevelBlock(level32, sourceBlockX, sourceBlockY) };
+								std::copy(pBlock, pBlock + blockWords, &page[(static_cast<size_t>(blockY) * blocksPerSide + blockX) * blockWords]);
+							}
+						}
+					}
+
+					file.write(reinterpret_cast<const char*>(page.data()), page.size() * sizeof(uint32_t));
+				}
+			}
+		}
+
+		file.close();
+		std::error_code error{};
+		if (file) std::filesystem::rename(temporaryPath, pageFilePath, error);
+		if (!file || error)
+		{
+			std::cout << "could not write page file " << pageFilePath << "\n";
+			return nullptr;
+		}
+
+		return Open(pageFilePath, memoryBudget);
+	}
+
+	std::unique_ptr<VirtualTexture> VirtualTexture::LoadFromCache(const std::string& cacheFile, size_t memoryBudget)
+	{
+		if (cacheFile.empty())
+		{
+			std::cout << "no texture cache file to page\n";
+			return nullptr;
+		}
+
+		//same key as the texture cache file, so the pages are written again when the image changes
+		const std::string pageFilePath{ std::filesystem::path{ cacheFile }.replace_extension(".vtx").string() };
+		if (std::unique_ptr<VirtualTexture> pTexture{ Open(pageFilePath, memoryBudget) }) return pTexture;
+
+		//the decoded texture the Texture load wrote, mapped while its pages are copied out
+		const std::unique_ptr<Texture> pSource{ Texture::MapFromFile(cacheFile) };
+		if (!pSource)
+		{
+			std::cout << "could not map texture cache " << cacheFile << "\n";
+			return nullptr;
+		}
+		return Create(*pSource, pageFilePath, memoryBudget);
+	}
+
+	std::unique_ptr<VirtualTexture> VirtualTexture::Open(const std::string& pageFilePath, size_t memoryBudget)
+	{
+		std::unique_ptr<VirtualTexture> pTexture{ new VirtualTexture{} };
+		pTexture->m_PageFile.open(pageFilePath, std::ios::binary);
+		if (!pTexture->m_PageFile.is_open()) return nullptr;
+
+		//a page file from another version or cut short returns nullptr, LoadFromCache then writes it again
+		uint32_t header[6]{};
+		if (!pTexture->m_PageFile.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != fileMagic || header[5] != pageSize
+			|| header[1] > static_cast<uint32_t>(TextureFormat::bc5bc1) || header[2] == 0 || header[3] == 0 || header[2] > 1 << 16 || header[3] > 1 << 16)
+		{
+			std::cout << "invalid page file " << pageFilePath << "\n";
+			return nullptr;
+		}
+
+		pTexture->m_Format = static_cast<TextureFormat>(header[1]);
+		pTexture->m_Levels = BuildLevels(static_cast<int>(header[2]), static_cast<int>(header[3]), pTexture->m_PageCount);
+		pTexture->m_PageWords = GetPageWords(pTexture->m_Format);
+		std::error_code error{};
+		const uintmax_t fileSize{ std::filesystem::file_size(pageFilePath, error) };
+		if (pTexture->m_Levels.size() != header[4] || error || fileSize != headerSize + static_cast<uintmax_t>(pTexture->m_PageCount) * pTexture->m_PageWords * sizeof(uint32_t))
+		{
+			std::cout << "invalid page file " << pageFilePath << "\n";
+			return nullptr;
+		}
+
+		//the mip tail is pinned on top of the budget, it is what every miss falls back to
+		uint32_t firstTailPage{ pTexture->m_PageCount };
+		for (const Level& level : pTexture->m_Levels)
+		{
+			if (level.pagesX == 1 && level.pagesY == 1)
+			{
+				firstTailPage = level.firstPage;
+				break;
+			}
+		}
+		const uint32_t tailPageCount{ pTexture->m_PageCount - firstTailPage };
+		const size_t pageBytes{ pTexture->m_PageWords * sizeof(uint32_t) };
+		const size_t cacheSlotCount{ std::max<size_t>(memoryBudget / pageBytes, 1) };
+		const size_t slotCount{ cacheSlotCount + tailPageCount };
+
+		pTexture->m_PageSlots.assign(pTexture->m_PageCount, -1);
+		pTexture->m_Slots.resize(slotCount);
+		pTexture->m_SlotData.resize(slotCount * pTexture->m_PageWords);
+		pTexture->m_pRequestedPages = std::make_unique<std::atomic<uint8_t>[]>(pTexture->m_PageCount);
+		pTexture->m_PendingPages.reserve(pTexture->m_PageCount);
+
+		for (uint32_t i{}; i < tailPageCount; ++i)
+		{
+			const int32_t slot{ static_cast<int32_t>(cacheSlotCount + i) };
+			pTexture->m_Slots[slot].isPinned = true;
+			if (!pTexture->LoadPage(firstTailPage + i, slot))
+			{
+				std::cout << "could not read the mip tail of " << pageFilePath << "\n";
+				return nullptr;
+			}
+		}
+
+		return pTexture;
+	}
+
+	bool VirtualTexture::LoadPage(uint32_t page, int32_t slot)
+	{
+		const size_t pageBytes{ m_PageWords * sizeof(uint32_t) };
+		m_PageFile.seekg(static_cast<std::streamoff>(headerSize + page * pageBytes));
+		if (!m_PageFile.read(reinterpret_cast<char*>(&m_SlotData[slot * m_PageWords]), static_cast<std::streamsize>(pageBytes)))
+		{
+			m_PageFile.clear();
+			return false;
+		}
+
+		Slot& slotInfo{ m_Slots[slot] };
+		if (slotInfo.page >= 0) m_PageSlots[slotInfo.page] = -1;
+
+		slotInfo.page = static_cast<int32_t>(page);
+		slotInfo.lastUsedFrame = m_Frame;
+		m_PageSlots[page] = slot;
+		return true;
+	}
+
+	int32_t VirtualTexture::FindVictimSlot() const
+	{
+		//a free slot, or the least recently used one that was not needed this frame
+		int32_t victim{ -1 };
+		for (int32_t slot{}; slot < static_cast<int32_t>(m_Slots.size()); ++slot)
+		{
+			const Slot& slotInfo{ m_Slots[slot] };
+			if (slotInfo.isPinned) continue;
+			if (slotInfo.page < 0) return slot;
+
+			if (slotInfo.lastUsedFrame < m_Frame && (victim < 0 || slotInfo.lastUsedFrame < m_Slots[victim].lastUsedFrame))
+			{
+				victim = slot;
+			}
+		}
+		return victim;
+	}
+
+	void VirtualTexture::Update()
+	{
+		++m_Frame;
+
+		m_PendingPages.clear();
+		for (uint32_t page{}; page < m_PageCount; ++page)
+		{
+			if (!m_pRequestedPages[page].exchange(0, std::memory_order_relaxed)) continue;
+
+			const int32_t slot{ m_PageSlots[page] };
+			if (slot >= 0)
+			{
+				m_Slots[slot].lastUsedFrame = m_Frame;
+			}
+			else
+			{
+				m_PendingPages.push_back(page);
+			}
+		}
+
+		//coarse levels first, they are what the fine levels fall back to
+		std::sort(m_PendingPages.begin(), m_PendingPages.end(), std::greater<uint32_t>{});
+
+		uint32_t pageLoads{};
+		for (uint32_t page : m_PendingPages)
+		{
+			if (pageLoads == maxPageLoadsPerFrame) break;
+
+			const int32_t slot{ FindVictimSlot() };
+			if (slot < 0) break; //every slot is needed this frame, the budget is too small for this view
+
+			if (LoadPage(page, slot)) ++pageLoads;
+		}
+
+		m_Stats.pageLoads = pageLoads;
+		m_Stats.missingPages = static_cast<uint32_t>(m_PendingPages.size()) - pageLoads;
+		m_Stats.residentPages = static_cast<uint32_t>(std::count_if(m_Slots.begin(), m_Slots.end(), [](const Slot& slot) { return !slot.isPinned && slot.page >= 0; }));
+	}
+
+	uint32_t VirtualTexture::DecodePageTexel(const uint32_t* pPage, int x, int y) const
+	{
+		if (m_Format == TextureFormat::rgba8)
+			return pPage[x + y * pageSize];
+
+		constexpr int blocksPerSide{ pageSize / 4 };
+		const int blockIndex{ (y >> 2) * blocksPerSide + (x >> 2) };
+		const int texelIndex{ ((y & 3) << 2) + (x & 3) };
+		return Texture::DecodeBlockTexel(m_Format, pPage + blockIndex * Texture::GetBlockWords(m_Format), texelIndex);
+	}
+
+	uint32_t VirtualTexture::FetchTexel(int level, int x, int y) const
+	{
+		//walk up the mip chain until a resident page is found, the tail always is
+		for (int currentLevel{ level };; ++currentLevel)
+		{
+			const Level& levelInfo{ m_Levels[currentLevel] };
+			const uint32_t page{ levelInfo.firstPage + static_cast<uint32_t>((y / pageSize) * levelInfo.pagesX + x / pageSize) };
+
+			if (currentLevel == level) m_pRequestedPages[page].store(1, std::memory_order_relaxed);
+
+			const int32_t slot{ m_PageSlots[page] };
+			if (slot >= 0)
+				return DecodePageTexel(&m_SlotData[slot * m_PageWords], x % pageSize, y % pageSize);
+
+			const Level& coarserLevel{ m_Levels[currentLevel + 1] };
+			x = std::min(x >> 1, coarserLevel.width - 1);
+			y = std::min(y >> 1, coarserLevel.height - 1);
+		}
+	}
+
+	Vector4 VirtualTexture::SampleBilinear(const Vector2& uv, int level) const
+	{
+		const Level& levelInfo{ m_Levels[level] };
+		const Texture::BilinearTexels texels{ Texture::LocateBilinear(uv, levelInfo.width, levelInfo.height) };
+
+		return Texture::FilterBilinear(Texture::BilinearFootprint
+			{
+				{ FetchTexel(level, texels.x0, texels.y0), FetchTexel(level, texels.x1, texels.y0), FetchTexel(level, texels.x0, texels.y1), FetchTexel(level, texels.x1, texels.y1) },
+				texels.fracX,
+				texels.fracY
+			});
+	}
+
+	Vector4 VirtualTexture::SampleRGBA(const Vector2& uv, TextureFilter filter, const UVDerivatives& derivatives) const
+	{
+		const int levelCount{ static_cast<int>(m_Levels.size()) };
+
+		if (filter == TextureFilter::point)
+		{
+			const Level& levelInfo{ m_Levels[0] };
+			const int x{ Texture::Wrap(static_cast<int>(std::floor(uv.x * levelInfo.width)), levelInfo.width) };
+			const int y{ Texture::Wrap(static_cast<int>(std::floor(uv.y * levelInfo.height)), levelInfo.height) };
+			const uint32_t texel{ FetchTexel(0, x, y) };
+			return Texture::FilterBilinear(Texture::BilinearFootprint{ { texel, texel, texel, texel }, 0.f, 0.f });
+		}
+
+		const Texture::MipSelection mip{ Texture::SelectMip(filter, derivatives, m_Levels[0].width, m_Levels[0].height, levelCount) };
+
+		const Vector4 sample0{ SampleBilinear(uv, mip.level0) };
+		if (mip.level0 == mip.level1 || mip.factor == 0.f) return sample0;
+
+		const Vector4 sample1{ SampleBilinear(uv, mip.level1) };
+		return sample0 + (sample1 - sample0) * mip.factor;
+	}
+
+	ColorRGB VirtualTexture::Sample(const Vector2& uv, TextureFilter filter, const UVDerivatives& derivatives) const
+	{
+		const Vector4 rgba{ SampleRGBA(uv, filter, derivatives) };
+		return { rgba.x, rgba.y, rgba.z };
+	}
+
+	Vector3 VirtualTexture::SampleNormal(const Vector2& uv, TextureFilter filter, const UVDerivatives& derivatives) const
+	{
+		const Vector4 rgba{ SampleRGBA(uv, filter, derivatives) };
+		return { rgba.x, rgba.y, rgba.z };
+	}
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Texture.h"
+
+namespace dae
+{
+	struct VirtualTextureStats
+	{
+		uint32_t residentPages{};
+		uint32_t pageLoads{};
+		uint32_t missingPages{};
+	};
+
+	//Texture split into fixed-size pages that live in a page file on disk, in the format of the source (compressed or RGBA8)
+	//only the pages sampled during the previous frame are kept in memory, in an LRU cache with a fixed memory budget
+	//the mip tail (every level that fits in one page) is always resident, so sampling a page that is not loaded
+	//falls back to the closest coarser level that is
+	class VirtualTexture final
+	{
+	public:
+		static constexpr int pageSize{ 128 };
+
+		//pages of a texture in the texture cache (Texture::GetCacheFile), the page file is written next to it
+		//an existing page file is opened as it is, otherwise the cache file is mapped only to write it
+		static std::unique_ptr<VirtualTexture> LoadFromCache(const std::string& cacheFile, size_t memoryBudget);
+		//writes the pages of source to pageFilePath and opens that file
+		static std::unique_ptr<VirtualTexture> Create(const Texture& source, const std::string& pageFilePath, size_t memoryBudget);
+		//opens an existing page file, the source texture does not have to be loaded, nullptr when it is missing or invalid
+		static std::unique_ptr<VirtualTexture> Open(const std::string& pageFilePath, size_t memoryBudget);
+
+		~VirtualTexture() = default;
+
+		VirtualTexture(const VirtualTexture&) = delete;
+		VirtualTexture(VirtualTexture&&) noexcept = delete;
+		VirtualTexture& operator=(const VirtualTexture&) = delete;
+		VirtualTexture& operator=(VirtualTexture&&) noexcept = delete;
+
+		//same filtering as Texture, every page that is touched is requested for the next Update
+		Vector4 SampleRGBA(const Vector2& uv, TextureFilter filter, const UVDerivatives& derivatives) const;
+		ColorRGB Sample(const Vector2& uv, TextureFilter filter, const UVDerivatives& derivatives) const;
+		Vector3 SampleNormal(const Vector2& uv, TextureFilter filter, const UVDerivatives& derivatives) const;
+
+		//once per frame, after rendering: loads the pages requested this frame (coarse levels first)
+		//into the least recently used slots, at most maxPageLoadsPerFrame to bound the hitch
+		void Update();
+
+		const VirtualTextureStats& GetStats() const { return m_Stats; }
+
+	private:
+		VirtualTexture() = default;
+
+		struct Level
+		{
+			int width{};
+			int height{};
+			int pagesX{};
+			int pagesY{};
+			uint32_t firstPage{};
+		};
+
+		struct Slot
+		{
+			int32_t page{ -1 };
+			uint64_t lastUsedFrame{};
+			bool isPinned{ false };
+		};
+
+		static constexpr uint32_t fileMagic{ 0x31585456 }; //"VTX1"
+		static constexpr uint32_t headerSize{ 6 * sizeof(uint32_t) };
+		static constexpr uint32_t maxPageLoadsPerFrame{ 32 };
+
+		std::ifstream m_PageFile{};
+		TextureFormat m_Format{ TextureFormat::rgba8 };
+		std::vector<Level> m_Levels{};
+		uint32_t m_PageCount{};
+		size_t m_PageWords{};
+
+		//page => slot (-1 when not resident), slot => page
+		std::vector<int32_t> m_PageSlots{};
+		std::vector<Slot> m_Slots{};
+		std::vector<uint32_t> m_SlotData{};
+
+		//written while sampling, read and cleared by Update
+		std::unique_ptr<std::atomic<uint8_t>[]> m_pRequestedPages{ nullptr };
+		std::vector<uint32_t> m_PendingPages{};
+
+		uint64_t m_Frame{};
+		VirtualTextureStats m_Stats{};
+
+		static std::vector<Level> BuildLevels(int width, int height, uint32_t& pageCount);
+		static size_t GetPageWords(TextureFormat format);
+
+		bool LoadPage(uint32_t page, int32_t slot);
+		int32_t FindVictimSlot() const;
+
+		uint32_t FetchTexel(int level, int x, int y) const;
+		uint32_t DecodePageTexel(const uint32_t* pPage, int x, int y) const;
+		Vector4 SampleBilinear(const Vector2& uv, int level) const;
+	};
+}
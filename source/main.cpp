@@ -71,6 +71,56 @@ int main(int argc, char* args[])
 					pRenderer->ToggleNormalMap();
 				else if (e.key.keysym.scancode == SDL_SCANCODE_F7)
 					pRenderer->ToggleRenderOutput();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F8)
+					pRenderer->ToggleTextureFilter();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F10)
+					pRenderer->ToggleVirtualTexture();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F11)
+				{
+					pRenderer->ToggleSpecularPower();
+					const SpecularPowerMode mode{ pRenderer->GetSpecularPowerMode() };
+					std::cout << "Specular power: " << SpecularPower::GetModeName(mode)
+						<< ", max error " << pRenderer->GetSpecularPower().GetMaxError(mode) << std::endl;
+				}
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F12)
+					pRenderer->ToggleTangentSpaceLighting();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_L)
+					pRenderer->ToggleLocalLights();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_P)
+				{
+					pRenderer->ToggleShadows();
+					std::cout << "Shadows: " << ShadowMap::GetFilterName(pRenderer->GetShadowFilter()) << std::endl;
+				}
+				else if (e.key.keysym.scancode == SDL_SCANCODE_M)
+				{
+					pRenderer->ToggleMultisample();
+					std::cout << "MSAA: " << (pRenderer->IsMultisampleOn() ? "4x" : "off") << std::endl;
+				}
+				else if (e.key.keysym.scancode == SDL_SCANCODE_V)
+				{
+					pRenderer->ToggleShadingRate();
+					std::cout << "Shading rate: " << Renderer::GetShadingRateModeName(pRenderer->GetShadingRateMode()) << std::endl;
+				}
+				else if (e.key.keysym.scancode == SDL_SCANCODE_T)
+				{
+					pRenderer->ToggleTemporalCache();
+					std::cout << "Temporal cache: " << (pRenderer->IsTemporalCacheOn() ? "on" : "off") << std::endl;
+				}
+				else if (e.key.keysym.scancode == SDL_SCANCODE_O)
+				{
+					pRenderer->ToggleOcclusionCulling();
+					std::cout << "Occlusion culling: " << (pRenderer->IsOcclusionCullingOn() ? "on" : "off") << std::endl;
+				}
+				else if (e.key.keysym.scancode == SDL_SCANCODE_C)
+				{
+					pRenderer->ToggleMeshletCulling();
+					std::cout << "Meshlet culling: " << (pRenderer->IsMeshletCullingOn() ? "on" : "off") << std::endl;
+				}
+				else if (e.key.keysym.scancode == SDL_SCANCODE_R)
+				{
+					pRenderer->ToggleDynamicResolution();
+					std::cout << "Dynamic resolution: " << (pRenderer->IsDynamicResolutionOn() ? "on" : "off") << std::endl;
+				}
 					break;
 			}
 		}
@@ -88,6 +138,34 @@ int main(int argc, char* args[])
 		{
 			printTimer = 0.f;
 			std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+
+			const Renderer::FrameStats& frameStats{ pRenderer->GetFrameStats() };
+			std::cout << "Frame arena: " << frameStats.arenaUsed / 1024 << " KB used, "
+				<< frameStats.arenaHighWaterMark / 1024 << " KB high-water mark, "
+				<< frameStats.heapAllocations << " heap allocations last frame" << std::endl;
+			std::cout << "Virtual textures: " << frameStats.virtualPagesResident << " pages resident, "
+				<< frameStats.virtualPageLoads << " loaded, " << frameStats.virtualPagesMissing << " missing last frame" << std::endl;
+			if (frameStats.lightTileCount > 0)
+			{
+				std::cout << "Light tiles: " << float(frameStats.lightTileAssignments) / frameStats.lightTileCount << " lights per tile, "
+					<< frameStats.lightsDroppedFromTiles << " dropped" << std::endl;
+			}
+			std::cout << "Shadow map: " << frameStats.shadowMapRenders << " renders" << std::endl;
+			std::cout << "Meshes: " << frameStats.meshesDrawn << " drawn, " << frameStats.meshesOccluded << " occluded, "
+				<< frameStats.meshesFrustumCulled << " outside the view" << std::endl;
+			if (pRenderer->IsMeshletCullingOn())
+			{
+				std::cout << "Meshlets: " << frameStats.meshletsDrawn << " drawn, " << frameStats.meshletsCulled << " culled" << std::endl;
+			}
+			if (pRenderer->IsTemporalCacheOn())
+			{
+				std::cout << "Temporal cache: " << frameStats.temporalReusedPixels << " pixels reused, "
+					<< frameStats.temporalShadedPixels << " shaded" << std::endl;
+			}
+			if (pRenderer->IsDynamicResolutionOn())
+			{
+				std::cout << "Render resolution: " << frameStats.renderWidth << "x" << frameStats.renderHeight << std::endl;
+			}
 		}
 
 		//Save screenshot after full render